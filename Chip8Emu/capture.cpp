@@ -0,0 +1,246 @@
+// *********************************************************
+//
+//			   ASYNCHRONOUS DISPLAY CAPTURE
+//
+// *********************************************************
+
+// header inclusion
+#include "capture.h"
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+// Function to append a variable-length unsigned integer, 7 bits per byte
+static void PutVarint(vector<uint8_t>& out, uint32_t value)
+{
+	while (value >= 0x80u) {
+		out.push_back(static_cast<uint8_t>(value | 0x80u));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+// Function to read a variable-length unsigned integer, returns false at the end of the stream
+static bool GetVarint(istream& in, uint32_t& value)
+{
+	value = 0;
+
+	for (unsigned int shift = 0; shift < 35; shift += 7) {
+		int byte = in.get();
+		if (byte == EOF) {
+			return false;
+		}
+
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Function to turn packed rows into frame bytes, leftmost pixel in the top bit
+static void RowsToBytes(uint64_t const* rows, uint8_t* bytes)
+{
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		for (unsigned int i = 0; i < 8; ++i) {
+			bytes[row * 8 + i] = static_cast<uint8_t>(rows[row] >> (56 - 8 * i));
+		}
+	}
+}
+
+// Function to run-length encode bytes as (zeros, literal count, literals) runs
+static void EncodeRuns(uint8_t const* bytes, unsigned int size, vector<uint8_t>& out)
+{
+	unsigned int i = 0;
+
+	while (i < size) {
+		unsigned int zeros = 0;
+		while (i + zeros < size && bytes[i + zeros] == 0) {
+			++zeros;
+		}
+		i += zeros;
+
+		// literals run until two zeros in a row, a single zero is cheaper to keep inline
+		unsigned int literals = 0;
+		while (i + literals < size && !(bytes[i + literals] == 0 && (i + literals + 1 == size || bytes[i + literals + 1] == 0))) {
+			++literals;
+		}
+
+		PutVarint(out, zeros);
+		PutVarint(out, literals);
+		out.insert(out.end(), bytes + i, bytes + i + literals);
+		i += literals;
+	}
+}
+
+// Recorder constructor declaration
+FrameRecorder::FrameRecorder(char const* filename, unsigned int framesPerSecond)
+	: file(filename, ios::binary)
+{
+	if (!file.is_open()) {
+		running = false;
+		return;
+	}
+
+	uint8_t header[] = { 'C', '8', 'V', 1, VIDEO_WIDTH, VIDEO_HEIGHT,
+		static_cast<uint8_t>(framesPerSecond), static_cast<uint8_t>(framesPerSecond >> 8) };
+	file.write(reinterpret_cast<char const*>(header), sizeof(header));
+
+	writer = std::thread(&FrameRecorder::WriterLoop, this);
+}
+
+// Recorder destructor declaration
+FrameRecorder::~FrameRecorder()
+{
+	Close();
+}
+
+// Function to stop the writer once it has written everything queued
+void FrameRecorder::Close()
+{
+	running = false;
+
+	if (writer.joinable()) {
+		writer.join();
+	}
+
+	if (file.is_open()) {
+		file.close();
+	}
+}
+
+// Function to queue a frame without blocking the emulation thread
+bool FrameRecorder::Submit(uint64_t const* display, uint32_t frame)
+{
+	uint32_t slot = head.load(std::memory_order_relaxed);
+
+	// the writer is a whole queue behind, so this frame is dropped
+	if (!running || slot - tail.load(std::memory_order_acquire) == QUEUE_SIZE) {
+		++dropped;
+		return false;
+	}
+
+	CapturedFrame& captured = queue[slot % QUEUE_SIZE];
+	captured.frame = frame;
+	memcpy(captured.rows, display, sizeof(captured.rows));
+
+	head.store(slot + 1, std::memory_order_release);
+	return true;
+}
+
+// Function run by the writer thread, encodes queued frames until the recorder is destroyed
+void FrameRecorder::WriterLoop()
+{
+	uint8_t previous[CAPTURE_FRAME_BYTES]{};
+	uint8_t current[CAPTURE_FRAME_BYTES];
+	uint8_t delta[CAPTURE_FRAME_BYTES];
+	uint32_t previousFrame = 0;
+	uint64_t records = 0;
+	vector<uint8_t> record;
+
+	while (true) {
+		uint32_t slot = tail.load(std::memory_order_relaxed);
+
+		// nothing queued: stop if the recorder is going away, otherwise wait for the next frame
+		if (slot == head.load(std::memory_order_acquire)) {
+			if (!running) {
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			continue;
+		}
+
+		CapturedFrame const& captured = queue[slot % QUEUE_SIZE];
+		RowsToBytes(captured.rows, current);
+
+		// the first record has no previous frame to measure a gap from
+		uint32_t gap = records == 0 ? 0 : captured.frame - previousFrame;
+		previousFrame = captured.frame;
+
+		tail.store(slot + 1, std::memory_order_release);
+
+		// periodic keyframes keep a damaged file decodable from the next one on
+		bool keyframe = records % KEYFRAME_INTERVAL == 0;
+		for (unsigned int i = 0; i < CAPTURE_FRAME_BYTES; ++i) {
+			delta[i] = keyframe ? current[i] : current[i] ^ previous[i];
+		}
+
+		record.clear();
+		PutVarint(record, gap);
+		record.push_back(keyframe ? CAPTURE_KEYFRAME : CAPTURE_DELTA);
+		EncodeRuns(delta, CAPTURE_FRAME_BYTES, record);
+		file.write(reinterpret_cast<char const*>(record.data()), record.size());
+
+		memcpy(previous, current, sizeof(previous));
+		++records;
+		++written;
+	}
+}
+
+// Function to open a capture file and check its header
+bool CaptureReader::Open(char const* filename)
+{
+	file.open(filename, ios::binary);
+
+	uint8_t header[8];
+	if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+		return false;
+	}
+
+	if (memcmp(header, "C8V\x01", 4) != 0 || header[4] != VIDEO_WIDTH || header[5] != VIDEO_HEIGHT) {
+		return false;
+	}
+
+	framesPerSecond = header[6] | (header[7] << 8);
+	return true;
+}
+
+// Function to decode the next captured frame
+bool CaptureReader::Next(CapturedFrame& frame)
+{
+	uint32_t gap;
+	if (!GetVarint(file, gap)) {
+		return false;
+	}
+
+	int type = file.get();
+	if (type != CAPTURE_KEYFRAME && type != CAPTURE_DELTA) {
+		return false;
+	}
+
+	uint8_t bytes[CAPTURE_FRAME_BYTES];
+	unsigned int i = 0;
+	while (i < CAPTURE_FRAME_BYTES) {
+		uint32_t zeros, literals;
+		if (!GetVarint(file, zeros) || !GetVarint(file, literals) || i + zeros + literals > CAPTURE_FRAME_BYTES) {
+			return false;
+		}
+
+		memset(bytes + i, 0, zeros);
+		i += zeros;
+
+		if (!file.read(reinterpret_cast<char*>(bytes + i), literals)) {
+			return false;
+		}
+		i += literals;
+	}
+
+	for (unsigned int b = 0; b < CAPTURE_FRAME_BYTES; ++b) {
+		previous[b] = type == CAPTURE_DELTA ? previous[b] ^ bytes[b] : bytes[b];
+	}
+
+	frameNumber += gap;
+	frame.frame = frameNumber;
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		uint64_t bits = 0;
+		for (unsigned int b = 0; b < 8; ++b) {
+			bits = (bits << 8) | previous[row * 8 + b];
+		}
+		frame.rows[row] = bits;
+	}
+
+	return true;
+}
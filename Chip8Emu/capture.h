@@ -0,0 +1,83 @@
+#pragma once
+#include "chip8.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// CAPTURE FILE FORMAT
+// Header: "C8V" 0x01, width (u8), height (u8), frames per second (u16 little endian)
+// Then one record per captured frame:
+//   frames since the previous record (varint, 0 for the first, more than 1 when frames were dropped)
+//   type (u8): CAPTURE_KEYFRAME holds the frame itself, CAPTURE_DELTA the XOR with the previous frame
+//   payload: the 256 packed frame bytes (1 bit per pixel, rows top to bottom) as runs of
+//            (zero count varint, literal count varint, literal bytes) until all 256 are covered
+
+const unsigned int CAPTURE_FRAME_BYTES = VIDEO_WIDTH * VIDEO_HEIGHT / 8;
+const uint8_t CAPTURE_KEYFRAME = 0;
+const uint8_t CAPTURE_DELTA = 1;
+
+// A frame of the display packed to one bit per pixel
+struct CapturedFrame {
+	uint32_t frame;
+	uint64_t rows[VIDEO_HEIGHT];
+};
+
+// Records display frames to a capture file from a background thread. Submit never blocks: frames
+// go into a fixed single-producer ring, and when the writer falls behind new frames are dropped
+// and counted instead, showing up in the file as a longer gap between records.
+class FrameRecorder
+{
+	public:
+		// opens filename and starts the writer thread
+		FrameRecorder(char const* filename, unsigned int framesPerSecond);
+
+		// writes out everything queued and closes the file
+		~FrameRecorder();
+
+		// same as the destructor, afterwards Written and Dropped are final
+		void Close();
+
+		bool IsOpen() const { return file.is_open(); }
+
+		// queues the display as emulated frame number frame, returns false if it had to be dropped
+		bool Submit(uint64_t const* display, uint32_t frame);
+
+		uint64_t Written() const { return written.load(); }
+		uint64_t Dropped() const { return dropped.load(); }
+
+	private:
+		static const unsigned int QUEUE_SIZE = 64;
+		static const unsigned int KEYFRAME_INTERVAL = 600;
+
+		void WriterLoop();
+
+		ofstream file;
+		std::thread writer;
+		std::atomic<bool> running{ true };
+
+		CapturedFrame queue[QUEUE_SIZE];
+		std::atomic<uint32_t> head{};	// next slot Submit fills
+		std::atomic<uint32_t> tail{};	// next slot the writer encodes
+
+		std::atomic<uint64_t> written{};
+		std::atomic<uint64_t> dropped{};
+};
+
+// Reads the frames of a capture file back, for offline conversion
+class CaptureReader
+{
+	public:
+		// opens filename and reads the header, returns false if it isn't a capture file
+		bool Open(char const* filename);
+
+		// decodes the next record into frame, returns false at the end of the file
+		bool Next(CapturedFrame& frame);
+
+		unsigned int FramesPerSecond() const { return framesPerSecond; }
+
+	private:
+		ifstream file;
+		unsigned int framesPerSecond{};
+		uint32_t frameNumber{};
+		uint8_t previous[CAPTURE_FRAME_BYTES]{};
+};
@@ -6,6 +6,11 @@
 
 // header inclusion
 #include "chip8.h"
+#include "debugger.h"
+#include "trace.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
 #include <random>
 #include <chrono>
 
@@ -21,6 +26,7 @@ const unsigned int START_ADDRESS = 0x200;	// starting memory location for any Ch
 const unsigned int FONT_SIZE = 80;			// 5 bytes per character, 16 characters
 const unsigned int FONT_START_ADDRESS = 0x50;
 
+
 // array of fontset (characters created in terms of bytes in hexadecimal)
 // Example of the letter 'F'
 // 11110000 = (0x)F0
@@ -48,69 +54,84 @@ uint8_t fontset[FONT_SIZE] = {
 	0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+// OPCODE DECODING
+// Every opcode is matched on all of its fixed bits, so Fx15 and Fx55 or 00E0 and 0000 are told apart
+constexpr uint8_t Chip8::DecodeInstruction(uint16_t opcode)
+{
+	unsigned int low = opcode & 0x000Fu;
+	unsigned int kk = opcode & 0x00FFu;
+
+	switch (opcode >> 12u) {
+	case 0x0:
+		return opcode == 0x00E0u ? INSTR_00E0 : opcode == 0x00EEu ? INSTR_00EE : INSTR_NULL;
+	case 0x1: return INSTR_1nnn;
+	case 0x2: return INSTR_2nnn;
+	case 0x3: return INSTR_3xkk;
+	case 0x4: return INSTR_4xkk;
+	case 0x5: return low == 0x0 ? INSTR_5xy0 : INSTR_NULL;
+	case 0x6: return INSTR_6xkk;
+	case 0x7: return INSTR_7xkk;
+	case 0x8:
+		switch (low) {
+		case 0x0: return INSTR_8xy0;
+		case 0x1: return INSTR_8xy1;
+		case 0x2: return INSTR_8xy2;
+		case 0x3: return INSTR_8xy3;
+		case 0x4: return INSTR_8xy4;
+		case 0x5: return INSTR_8xy5;
+		case 0x6: return INSTR_8xy6;
+		case 0x7: return INSTR_8xy7;
+		case 0xE: return INSTR_8xyE;
+		default: return INSTR_NULL;
+		}
+	case 0x9: return low == 0x0 ? INSTR_9xy0 : INSTR_NULL;
+	case 0xA: return INSTR_Annn;
+	case 0xB: return INSTR_Bnnn;
+	case 0xC: return INSTR_Cxkk;
+	case 0xD: return INSTR_Dxyn;
+	case 0xE:
+		return kk == 0x9E ? INSTR_Ex9E : kk == 0xA1 ? INSTR_ExA1 : INSTR_NULL;
+	default:
+		switch (kk) {
+		case 0x07: return INSTR_Fx07;
+		case 0x0A: return INSTR_Fx0A;
+		case 0x15: return INSTR_Fx15;
+		case 0x18: return INSTR_Fx18;
+		case 0x1E: return INSTR_Fx1E;
+		case 0x29: return INSTR_Fx29;
+		case 0x33: return INSTR_Fx33;
+		case 0x55: return INSTR_Fx55;
+		case 0x65: return INSTR_Fx65;
+		default: return INSTR_NULL;
+		}
+	}
+}
+
+// DECLARATION OF DECODE TABLE
+// Built once at compile time and shared by every Chip8, so constructing one doesn't touch it
+constexpr Chip8::DispatchTables Chip8::BuildDispatch()
+{
+	DispatchTables tables{};
+
+	for (unsigned int op = 0; op <= 0xFFFFu; ++op) {
+		tables.decode[op] = DecodeInstruction(static_cast<uint16_t>(op));
+	}
+
+	return tables;
+}
+
+// BuildDispatch is constexpr, so the table is constant-initialized into read-only data
+const Chip8::DispatchTables Chip8::dispatch = Chip8::BuildDispatch();
+
 // Chip8 constructor declaration
 Chip8::Chip8()
-	: randGen(std::chrono::system_clock::now().time_since_epoch().count())
+	: randGen(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()))
 {
 	// Sets the program counter to the starting address in memory
 	program_counter = START_ADDRESS;
 
 	// loads in fontset into memory
-	for (unsigned int i = 0; i < FONT_SIZE; i++) {
-		memory[FONT_START_ADDRESS + i] = fontset[i];
-	}
-
-	// initializes the random number generator
-	randByte = std::uniform_int_distribution<uint16_t>(0, 255U);
-
-	// DECLARATION OF FUNCTION POINTER TABLE
-	// First unique set of opcodes
-	table[0x0] = &Chip8::Table0;
-	table[0x1] = &Chip8::OP_1nnn;
-	table[0x2] = &Chip8::OP_2nnn;
-	table[0x3] = &Chip8::OP_3xkk;
-	table[0x4] = &Chip8::OP_4xkk;
-	table[0x5] = &Chip8::OP_5xy0;
-	table[0x6] = &Chip8::OP_6xkk;
-	table[0x7] = &Chip8::OP_7xkk;
-	table[0x8] = &Chip8::Table8;
-	table[0x9] = &Chip8::OP_9xy0;
-	table[0xA] = &Chip8::OP_Annn;
-	table[0xB] = &Chip8::OP_Bnnn;
-	table[0xC] = &Chip8::OP_Cxkk;
-	table[0xD] = &Chip8::OP_Dxyn;
-	table[0xE] = &Chip8::TableE;
-	table[0xF] = &Chip8::TableF;
-
-	// Second set of opcodes
-	table0[0x0] = &Chip8::OP_00E0;
-	table0[0xE] = &Chip8::OP_00EE;
-
-	// Third set of opcodes
-	table8[0x0] = &Chip8::OP_8xy0;
-	table8[0x1] = &Chip8::OP_8xy1;
-	table8[0x2] = &Chip8::OP_8xy2;
-	table8[0x3] = &Chip8::OP_8xy3;
-	table8[0x4] = &Chip8::OP_8xy4;
-	table8[0x5] = &Chip8::OP_8xy5;
-	table8[0x6] = &Chip8::OP_8xy6;
-	table8[0x7] = &Chip8::OP_8xy7;
-	table8[0xE] = &Chip8::OP_8xyE;
-
-	// Fourth set of opcodes
-	tableE[0x1] = &Chip8::OP_ExA1;
-	tableE[0xE] = &Chip8::OP_Ex9E;
-
-	// Fifth set of opcodes
-	tableF[0x07] = &Chip8::OP_Fx07;
-	tableF[0x0A] = &Chip8::OP_Fx0A;
-	tableF[0x15] = &Chip8::OP_Fx15;
-	tableF[0x18] = &Chip8::OP_Fx18;
-	tableF[0x1E] = &Chip8::OP_Fx1E;
-	tableF[0x29] = &Chip8::OP_Fx29;
-	tableF[0x33] = &Chip8::OP_Fx33;
-	tableF[0x55] = &Chip8::OP_Fx55;
-	tableF[0x65] = &Chip8::OP_Fx65;
+	memcpy(memory + FONT_START_ADDRESS, fontset, FONT_SIZE);
 }
 
 // Rom loading function declaration
@@ -134,32 +155,20 @@ void Chip8::LoadROM(char const* filename) {
 		rom_file.close();
 
 		// loads the ROM into the respective memory slot in Chip8 interpreter
-		for (long i = 0; i < size; i++) {
-
-			// iterates as long as size and goes storing into memory 
-			memory[START_ADDRESS + i] = buffer[i];
-
-		}
+		LoadROM(reinterpret_cast<uint8_t const*>(buffer), static_cast<size_t>(size));
 
 		// delets dynamically allocated buffer array
 		delete[] buffer;
 	}
 }
 
-void Chip8::Table0() {
-	((*this).*(table0[opcode & 0x000Fu]))();
-}
-
-void Chip8::Table8() {
-	((*this).*(table8[opcode & 0x000Fu]))();
-}
+// Rom loading from a buffer, used by the file loader and the fuzzer
+void Chip8::LoadROM(uint8_t const* data, size_t size) {
 
-void Chip8::TableE() {
-	((*this).*(tableE[opcode & 0x000Fu]))();
-}
-
-void Chip8::TableF() {
-	((*this).*(tableF[opcode & 0x000Fu]))();
+	// anything past the end of memory is dropped rather than written over the rest of the object
+	size = std::min(size, static_cast<size_t>(MEMORY_SIZE - START_ADDRESS));
+	memcpy(memory + START_ADDRESS, data, size);
+	dirtyPages = 0xFFFFu;
 }
 
 // Save function in case no opcode is found
@@ -167,13 +176,28 @@ void Chip8::OP_NULL() {}
 
 // Function to clear the screen when ROM calls it
 void Chip8::OP_00E0() {
-	// clears the screen with memset
-	memset(display, 0, sizeof(display));
+	// clears the screen with memset, unless nothing was drawn since the last time: a clear of a blank
+	// display changes nothing, so it shouldn't mark every row dirty for the recorders and viewers either
+	if (!displayBlank) {
+		memset(display, 0, sizeof(display));
+		dirtyRows = 0xFFFFFFFFu;
+		displayBlank = true;
+
+		if (stopOnDisplay) {
+			pendingStop = STOP_DISPLAY;
+		}
+	}
 }
 
 // Function to return from a subroutine
 void Chip8::OP_00EE()
 {
+	// returning with nothing on the stack stops the machine
+	if (stack_pointer == 0 || stack_pointer > STACK_LEVELS) {
+		Trap(FAULT_STACK_UNDERFLOW);
+		return;
+	}
+
 	// decremements the stack pointer
 	--stack_pointer;
 
@@ -197,6 +221,12 @@ void Chip8::OP_2nnn()
 	// creates address with location
 	uint16_t address = opcode & 0x0FFFu;
 
+	// calling with every stack level in use stops the machine
+	if (stack_pointer >= STACK_LEVELS) {
+		Trap(FAULT_STACK_OVERFLOW);
+		return;
+	}
+
 	// access the index of stack usiing the pointer then assign to program counter
 	stack[stack_pointer] = program_counter;
 
@@ -440,8 +470,8 @@ void Chip8::OP_Bnnn()
 	// declare variable address
 	uint16_t address = opcode & 0x0FFFu;
 
-	// program_counter equals the register at index 0 plus address declared
-	program_counter = registers[0] + address;
+	// program_counter equals the register at index 0 plus address declared, wrapping at the end of memory
+	program_counter = (registers[0] + address) & ADDRESS_MASK;
 }
 
 // Set Vx = random byte AND kk.
@@ -451,8 +481,8 @@ void Chip8::OP_Cxkk()
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t byte = opcode & 0x00FFu;
 
-	// generate a random byte and assign it to the register
-	registers[Vx] = randByte(randGen) & byte;
+	// generate a random byte from the middle of the generator's output and assign it to the register
+	registers[Vx] = static_cast<uint8_t>(randGen() >> 8u) & byte;
 }
 
 // Function to display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision
@@ -468,24 +498,34 @@ void Chip8::OP_Dxyn() {
 	registers[0xF] = 0;
 
 	for (unsigned int row = 0; row < height; ++row) {
-		uint8_t spriteByte = memory[index + row];
-
-		for (unsigned int col = 0; col < 8; ++col) {
-			uint8_t spritePixel = spriteByte & (0x80u >> col);
-			uint32_t* screenPixel = &display[(yPos + row) * VIDEO_WIDTH + (xPos + col)];
+		uint8_t spriteByte = memory[(index + row) & ADDRESS_MASK];
+		if (!spriteByte) {
+			continue;
+		}
 
-			// if sprite exists
-			if (spritePixel) {
+		// the sprite row lands in one display row, except near the right edge where the pixels past
+		// it run on into the start of the next row, and past the bottom rows wrap to the top
+		uint64_t bits = static_cast<uint64_t>(spriteByte) << (VIDEO_WIDTH - 8);
+		uint64_t here = bits >> xPos;
+		uint64_t spill = xPos > VIDEO_WIDTH - 8 ? bits << (VIDEO_WIDTH - xPos) : 0;
+		unsigned int y = (yPos + row) % VIDEO_HEIGHT;
+		unsigned int next = (y + 1) % VIDEO_HEIGHT;
+
+		// any lit pixel the sprite lands on is a collision, then the sprite is XORed in
+		if ((display[y] & here) || (display[next] & spill)) {
+			registers[0xF] = 1;
+		}
+		display[y] ^= here;
+		display[next] ^= spill;
 
-				// if this is true, it means collision is occuring 
-				if (*screenPixel == 0xFFFFFFFF) {
-					// sets VF to 1
-					registers[0xF] = 1;
-				}
+		displayBlank = false;
+		dirtyRows |= 1u << y;
+		if (spill) {
+			dirtyRows |= 1u << next;
+		}
 
-				// XOR sprite
-				*screenPixel ^= 0xFFFFFFFF;
-			}
+		if (stopOnDisplay) {
+			pendingStop = STOP_DISPLAY;
 		}
 	}
 }
@@ -496,8 +536,8 @@ void Chip8::OP_Ex9E() {
 	// declare Vx
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
-	// declare key and set it to register Vx
-	uint8_t key = registers[Vx];
+	// declare key and set it to register Vx, only the low nibble names a key
+	uint8_t key = registers[Vx] & 0x0Fu;
 
 	// if keys at key is True
 	if (keys[key])
@@ -511,8 +551,8 @@ void Chip8::OP_ExA1() {
 	// declare Vx
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
-	// declare key and set it to register Vx
-	uint8_t key = registers[Vx];
+	// declare key and set it to register Vx, only the low nibble names a key
+	uint8_t key = registers[Vx] & 0x0Fu;
 
 	// if keys at key is True
 	if (!keys[key])
@@ -639,15 +679,18 @@ void Chip8::OP_Fx33()
 	uint8_t value = registers[Vx];
 
 	// Ones-place
-	memory[index + 2] = value % 10;
+	memory[(index + 2) & ADDRESS_MASK] = value % 10;
 	value /= 10;
 
 	// Tens-place
-	memory[index + 1] = value % 10;
+	memory[(index + 1) & ADDRESS_MASK] = value % 10;
 	value /= 10;
 
 	// Hundreds-place
-	memory[index] = value % 10;
+	memory[index & ADDRESS_MASK] = value % 10;
+
+	// the written bytes may have been part of a fused sequence
+	MemoryWritten(index, 3);
 }
 
 
@@ -660,8 +703,11 @@ void Chip8::OP_Fx55()
 	// makes memory equal the register index +1
 	for (uint8_t i = 0; i <= Vx; ++i)
 	{
-		memory[index + i] = registers[i];
+		memory[(index + i) & ADDRESS_MASK] = registers[i];
 	}
+
+	// the written bytes may have been part of a fused sequence
+	MemoryWritten(index, Vx + 1u);
 }
 
 // Function to read registers V0 through Vx from memory starting at location I
@@ -673,22 +719,141 @@ void Chip8::OP_Fx65()
 	// makes register equal memory index +1
 	for (uint8_t i = 0; i <= Vx; ++i)
 	{
-		registers[i] = memory[index + i];
+		registers[i] = memory[(index + i) & ADDRESS_MASK];
 	}
 }
 
-//Fetch, Decode, Execute
+// Fetch, Decode, Execute one instruction through RunCycles, so a host stepping one at a time
+// gets the same debugger and fault handling as one running batches
 void Chip8::Cycle()
 {
-	// Fetch
-	opcode = (memory[program_counter] << 8u) | memory[program_counter + 1];
+	RunCycles(1);
+}
+
+//Fetch, Decode, Execute
+void Chip8::Step()
+{
+	// Fetch, a PC that ran off the end of memory wraps around to the start
+	uint16_t pc = program_counter & ADDRESS_MASK;
+	opcode = (memory[pc] << 8u) | memory[(pc + 1) & ADDRESS_MASK];
 
 	// Increment the PC before we execute anything
-	program_counter += 2;
+	program_counter = pc + 2;
 
 	// Decode and Execute
-	((*this).*(table[(opcode & 0xF000u) >> 12u]))();
+	switch (dispatch.decode[opcode]) {
+	case INSTR_00E0: OP_00E0(); break;
+	case INSTR_00EE: OP_00EE(); break;
+	case INSTR_1nnn: OP_1nnn(); break;
+	case INSTR_2nnn: OP_2nnn(); break;
+	case INSTR_3xkk: OP_3xkk(); break;
+	case INSTR_4xkk: OP_4xkk(); break;
+	case INSTR_5xy0: OP_5xy0(); break;
+	case INSTR_6xkk: OP_6xkk(); break;
+	case INSTR_7xkk: OP_7xkk(); break;
+	case INSTR_8xy0: OP_8xy0(); break;
+	case INSTR_8xy1: OP_8xy1(); break;
+	case INSTR_8xy2: OP_8xy2(); break;
+	case INSTR_8xy3: OP_8xy3(); break;
+	case INSTR_8xy4: OP_8xy4(); break;
+	case INSTR_8xy5: OP_8xy5(); break;
+	case INSTR_8xy6: OP_8xy6(); break;
+	case INSTR_8xy7: OP_8xy7(); break;
+	case INSTR_8xyE: OP_8xyE(); break;
+	case INSTR_9xy0: OP_9xy0(); break;
+	case INSTR_Annn: OP_Annn(); break;
+	case INSTR_Bnnn: OP_Bnnn(); break;
+	case INSTR_Cxkk: OP_Cxkk(); break;
+	case INSTR_Dxyn: OP_Dxyn(); break;
+	case INSTR_Ex9E: OP_Ex9E(); break;
+	case INSTR_ExA1: OP_ExA1(); break;
+	case INSTR_Fx07: OP_Fx07(); break;
+	case INSTR_Fx0A: OP_Fx0A(); break;
+	case INSTR_Fx15: OP_Fx15(); break;
+	case INSTR_Fx18: OP_Fx18(); break;
+	case INSTR_Fx1E: OP_Fx1E(); break;
+	case INSTR_Fx29: OP_Fx29(); break;
+	case INSTR_Fx33: OP_Fx33(); break;
+	case INSTR_Fx55: OP_Fx55(); break;
+	case INSTR_Fx65: OP_Fx65(); break;
+
+	// undefined opcodes do nothing
+	default: OP_NULL(); break;
+	}
+
+	// Decrement the timers
+	TickTimers();
+}
+
+// Function to execute one instruction and record it in the trace
+void Chip8::TracedStep()
+{
+	TraceRecord record;
+	record.pc = program_counter & ADDRESS_MASK;
+	record.opcode = (memory[record.pc] << 8u) | memory[(record.pc + 1) & ADDRESS_MASK];
+
+	uint8_t before[REGISTER_COUNT];
+	memcpy(before, registers, sizeof(before));
+
+	Step();
+
+	// VF has a field of its own, most instructions that touch it only do so as a flag
+	record.reg = TRACE_NO_REGISTER;
+	record.value = 0;
+	if (memcmp(before, registers, REGISTER_COUNT - 1) != 0) {
+		for (uint8_t i = 0; i < REGISTER_COUNT - 1; ++i) {
+			if (registers[i] != before[i]) {
+				record.reg = i;
+				record.value = registers[i];
+				break;
+			}
+		}
+	}
+	record.index = index;
+	record.vf = registers[0xF];
+
+	tracer->Record(record);
+}
 
+// Function to stop the machine, the faulting instruction is left at the PC for debuggers to see
+void Chip8::Trap(Chip8Fault kind)
+{
+	fault = kind;
+	pendingStop = STOP_FAULT;
+	program_counter -= 2;
+}
+
+// Function to return the display rows changed since the last call, and start over
+uint32_t Chip8::TakeDirtyRows()
+{
+	uint32_t rows = dirtyRows;
+	dirtyRows = 0;
+	return rows;
+}
+
+// Function to expand the display to a 32-bit pixel per display pixel
+void Chip8::RenderPixels(uint32_t* pixels) const
+{
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		uint64_t bits = display[row];
+
+		for (unsigned int col = 0; col < VIDEO_WIDTH; ++col) {
+			*pixels++ = ((bits >> (VIDEO_WIDTH - 1 - col)) & 1u) ? 0xFFFFFFFFu : 0u;
+		}
+	}
+}
+
+// Function to hand out the memory pages written since the last call
+uint16_t Chip8::TakeDirtyPages()
+{
+	uint16_t pages = dirtyPages;
+	dirtyPages = 0;
+	return pages;
+}
+
+// Function to decrement the delay and sound timers if they've been set
+void Chip8::TickTimers()
+{
 	// Decrement the delay timer if it's been set
 	if (delayTimer > 0)
 	{
@@ -700,4 +865,421 @@ void Chip8::Cycle()
 	{
 		--soundTimer;
 	}
-}
\ No newline at end of file
+}
+
+// SUPERINSTRUCTIONS
+// A handful of opcode sequences dominate real ROMs, so RunCycles executes them with a single
+// dispatch. The fused handlers call the same OP_ functions and tick the timers after each
+// instruction, so the result is identical to running Step() once per instruction.
+// Fusions are decoded from the instructions at the PC each time it gets there, so a skip that lands
+// in the middle of a sequence decodes from there and writes to memory need no bookkeeping. Keeping
+// a decode per address instead would cost every machine 4 KB, as much as its memory.
+
+// number of instructions in each FusionKind
+const unsigned int FUSION_LENGTH[] = { 1, 2, 2, 3, 2, 3, 1, 1 };
+
+// IDLE LOOPS
+// Games spend most of their instructions in loops that only wait: Fx07, 3x00, 1nnn polling the
+// delay timer, Fx0A re-executing itself until a key is down, or a 1nnn jumping to itself. Neither has side effects besides
+// the timers and Vx, so RunCycles works out where the loop ends and jumps there directly.
+// Keys only change between RunCycles calls, so a key wait can consume the whole batch.
+
+// Function to work out which superinstruction (if any) starts at address
+uint8_t Chip8::DecodeFusion(uint16_t address) const
+{
+	if (address + 2u > MEMORY_SIZE) {
+		return FUSE_NONE;
+	}
+
+	uint16_t first = (memory[address] << 8u) | memory[address + 1];
+
+	// Fx0A
+	if ((first & 0xF0FFu) == 0xF00Au) {
+		return FUSE_IDLE_KEY;
+	}
+
+	// 1nnn to itself
+	if (first == (0x1000u | address)) {
+		return FUSE_IDLE_HALT;
+	}
+
+	// everything else needs at least two whole instructions in memory
+	if (address + 4u > MEMORY_SIZE) {
+		return FUSE_NONE;
+	}
+
+	uint16_t second = (memory[address + 2] << 8u) | memory[address + 3];
+
+	switch ((first & 0xF000u) >> 12u) {
+	case 0x6:
+		// 6xkk, 6xkk
+		if ((second & 0xF000u) == 0x6000u) {
+			return FUSE_6XKK_6XKK;
+		}
+		break;
+
+	case 0x7:
+		// 7xkk, 3xkk, 1nnn
+		if ((second & 0xF000u) == 0x3000u && address + 6u <= MEMORY_SIZE && (memory[address + 4] & 0xF0u) == 0x10u) {
+			return FUSE_7XKK_3XKK_1NNN;
+		}
+		break;
+
+	case 0xA:
+		// Annn, Dxyn
+		if ((second & 0xF000u) == 0xD000u) {
+			return FUSE_ANNN_DXYN;
+		}
+		break;
+
+	case 0xF:
+		// Fx07, 3xkk, 1nnn jumping back to the Fx07
+		if ((first & 0x00FFu) == 0x07u && (second & 0xFF00u) == (0x3000u | (first & 0x0F00u)) && address + 6u <= MEMORY_SIZE) {
+			uint16_t third = (memory[address + 4] << 8u) | memory[address + 5];
+			if (third == (0x1000u | address)) {
+				return FUSE_IDLE_DELAY;
+			}
+		}
+
+		// Fx07, 3xkk
+		if ((first & 0x00FFu) == 0x07u && (second & 0xF000u) == 0x3000u) {
+			return FUSE_FX07_3XKK;
+		}
+		break;
+	}
+
+	return FUSE_NONE;
+}
+
+// Function to record a write to memory, which wraps at the end like the write itself
+void Chip8::MemoryWritten(unsigned int address, unsigned int length)
+{
+	// no write is longer than a page, so it touches at most two
+	dirtyPages |= static_cast<uint16_t>(1u << ((address & ADDRESS_MASK) / MEMORY_PAGE_SIZE));
+	dirtyPages |= static_cast<uint16_t>(1u << (((address + length - 1) & ADDRESS_MASK) / MEMORY_PAGE_SIZE));
+}
+
+// Function to fold bytes into a running 64-bit hash, a word at a time
+static uint64_t HashBytes(uint64_t hash, void const* data, size_t size)
+{
+	uint8_t const* bytes = static_cast<uint8_t const*>(data);
+	size_t i = 0;
+
+	// four independent lanes over the bulk, memory and the display are most of the state
+	uint64_t lanes[4] = { hash, hash ^ 1, hash ^ 2, hash ^ 3 };
+	for (; i + 32 <= size; i += 32) {
+		for (unsigned int lane = 0; lane < 4; ++lane) {
+			uint64_t word;
+			memcpy(&word, bytes + i + lane * 8, 8);
+			lanes[lane] = (lanes[lane] ^ word) * 0x100000001B3ull;
+			lanes[lane] ^= lanes[lane] >> 29;
+		}
+	}
+	if (i > 0) {
+		hash = lanes[0] ^ (lanes[1] * 3) ^ (lanes[2] * 5) ^ (lanes[3] * 7);
+	}
+
+	for (; i < size; i += 8) {
+		uint64_t word = 0;
+		memcpy(&word, bytes + i, std::min<size_t>(8, size - i));
+		hash = (hash ^ word) * 0x100000001B3ull;
+		hash ^= hash >> 29;
+	}
+
+	return hash;
+}
+
+// Function to hash everything that decides how the machine runs from here on
+uint64_t Chip8::StateHash() const
+{
+	// only the live part of the stack, stale entries above it are never read
+	uint16_t scalars[] = { index, program_counter, stack_pointer, delayTimer, soundTimer, fault };
+	unsigned int levels = std::min<unsigned int>(stack_pointer, STACK_LEVELS);
+
+	// the generator's next output stands in for its state, the two map one to one
+	std::minstd_rand generator = randGen;
+	uint32_t random = static_cast<uint32_t>(generator());
+
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash = HashBytes(hash, registers, sizeof(registers));
+	hash = HashBytes(hash, scalars, sizeof(scalars));
+	hash = HashBytes(hash, stack, levels * sizeof(stack[0]));
+	hash = HashBytes(hash, &random, sizeof(random));
+	hash = HashBytes(hash, memory, sizeof(memory));
+	hash = HashBytes(hash, display, sizeof(display));
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+// Function to seed the random number generator
+void Chip8::SeedRandom(uint32_t seed)
+{
+	randGen.seed(seed);
+}
+
+// Function to enable or disable superinstruction fusion
+void Chip8::SetFusion(bool enabled)
+{
+	fusionEnabled = enabled;
+}
+
+// Function to decrease a timer by ticks, stopping at zero
+static uint8_t ElapseTimer(uint8_t timer, unsigned int ticks)
+{
+	return timer > ticks ? static_cast<uint8_t>(timer - ticks) : 0;
+}
+
+// Function to count the whole iterations of an Fx07, 3xkk, 1nnn delay poll before the one that exits,
+// or UINT_MAX if the poll never reads byte
+static unsigned int DelayPollIterations(uint8_t delay, uint8_t byte)
+{
+	// each iteration reads the delay timer 3 ticks lower than the one before, stopping at 0,
+	// and the loop is left by the first iteration that reads byte
+	if (byte == 0) {
+		return (delay + 2u) / 3u;
+	}
+	if (delay >= byte && (delay - byte) % 3 == 0) {
+		return (delay - byte) / 3u;
+	}
+	return UINT_MAX;
+}
+
+// Function to work out what the machine is idling on
+Chip8Wait Chip8::Waiting(unsigned int& idleInstructions) const
+{
+	idleInstructions = 0;
+
+	if (fault != FAULT_NONE) {
+		return WAIT_HALTED;
+	}
+
+	uint16_t pc = program_counter & ADDRESS_MASK;
+
+	switch (DecodeFusion(pc)) {
+	case FUSE_IDLE_KEY:
+		for (unsigned int i = 0; i < KEY_COUNT; ++i) {
+			if (keys[i]) {
+				return WAIT_NONE;
+			}
+		}
+		return WAIT_KEY;
+
+	case FUSE_IDLE_HALT:
+		return WAIT_HALTED;
+
+	case FUSE_IDLE_DELAY: {
+		uint8_t byte = memory[(pc + 3) & ADDRESS_MASK];
+		unsigned int iterations = DelayPollIterations(delayTimer, byte);
+
+		if (iterations == UINT_MAX) {
+			return WAIT_HALTED;
+		}
+		idleInstructions = 3 * iterations;
+		return WAIT_DELAY_TIMER;
+	}
+	}
+
+	return WAIT_NONE;
+}
+
+// Function to execute a fused sequence starting at the program counter
+unsigned int Chip8::RunFused(uint8_t kind, unsigned int budget)
+{
+	// fetches are masked like Step's: a one-instruction kind can start at 0xFFE, with nothing after it
+	uint16_t start = program_counter & ADDRESS_MASK;
+	uint16_t first = (memory[start] << 8u) | memory[(start + 1) & ADDRESS_MASK];
+	uint16_t second = (memory[(start + 2) & ADDRESS_MASK] << 8u) | memory[(start + 3) & ADDRESS_MASK];
+
+	switch (kind) {
+	case FUSE_IDLE_DELAY: {
+		uint8_t Vx = (first & 0x0F00u) >> 8u;
+		uint8_t byte = second & 0x00FFu;
+		unsigned int iterations = std::min(budget / 3, DelayPollIterations(delayTimer, byte));
+
+		// the exiting iteration (or a partial one at the end of the budget) runs normally
+		if (iterations == 0) {
+			break;
+		}
+
+		// state after the last whole iteration, which ended on the jump back to start
+		registers[Vx] = ElapseTimer(delayTimer, 3 * (iterations - 1));
+		delayTimer = ElapseTimer(delayTimer, 3 * iterations);
+		soundTimer = ElapseTimer(soundTimer, 3 * iterations);
+		opcode = 0x1000u | start;
+		return 3 * iterations;
+	}
+
+	case FUSE_IDLE_KEY: {
+		// a key is down, Fx0A completes
+		for (unsigned int i = 0; i < KEY_COUNT; ++i) {
+			if (keys[i]) {
+				Step();
+				return 1;
+			}
+		}
+
+		// no key can arrive before the batch ends, so Fx0A repeats for all of it
+		opcode = first;
+		delayTimer = ElapseTimer(delayTimer, budget);
+		soundTimer = ElapseTimer(soundTimer, budget);
+		return budget;
+	}
+
+	case FUSE_IDLE_HALT:
+		// nothing but the timers changes until the end of time
+		opcode = first;
+		delayTimer = ElapseTimer(delayTimer, budget);
+		soundTimer = ElapseTimer(soundTimer, budget);
+		return budget;
+
+	case FUSE_ANNN_DXYN:
+		opcode = first;
+		program_counter += 2;
+		OP_Annn();
+		TickTimers();
+
+		opcode = second;
+		program_counter += 2;
+		OP_Dxyn();
+		TickTimers();
+		return 2;
+
+	case FUSE_6XKK_6XKK:
+		opcode = first;
+		program_counter += 2;
+		OP_6xkk();
+		TickTimers();
+
+		opcode = second;
+		program_counter += 2;
+		OP_6xkk();
+		TickTimers();
+		return 2;
+
+	case FUSE_7XKK_3XKK_1NNN:
+		opcode = first;
+		program_counter += 2;
+		OP_7xkk();
+		TickTimers();
+
+		opcode = second;
+		program_counter += 2;
+		OP_3xkk();
+		TickTimers();
+
+		// the compare skipped over the jump
+		if (program_counter != start + 4) {
+			return 2;
+		}
+
+		opcode = (memory[(start + 4) & ADDRESS_MASK] << 8u) | memory[(start + 5) & ADDRESS_MASK];
+		program_counter += 2;
+		OP_1nnn();
+		TickTimers();
+		return 3;
+
+	case FUSE_FX07_3XKK:
+		opcode = first;
+		program_counter += 2;
+		OP_Fx07();
+		TickTimers();
+
+		opcode = second;
+		program_counter += 2;
+		OP_3xkk();
+		TickTimers();
+		return 2;
+	}
+
+	Step();
+	return 1;
+}
+
+// Function to run up to count instructions, fusing common sequences
+Chip8Run Chip8::RunCycles(unsigned int count)
+{
+	Chip8Run run{ STOP_BUDGET, 0 };
+
+	// instructions that can start a superinstruction, a bit per Instruction; only these are decoded further
+	constexpr uint64_t fusionHeads = (1ull << INSTR_1nnn) | (1ull << INSTR_6xkk) | (1ull << INSTR_7xkk) |
+		(1ull << INSTR_Annn) | (1ull << INSTR_Fx07) | (1ull << INSTR_Fx0A);
+
+	if (fault != FAULT_NONE) {
+		run.stop = STOP_FAULT;
+		return run;
+	}
+
+	// one check per batch, instructions only pay for debugging while something is being watched
+	if (debugger && debugger->Active()) {
+		run.executed = debugger->Run(*this, count);
+		if (debugger->LastStop() != DEBUG_NONE) {
+			run.stop = fault != FAULT_NONE ? STOP_FAULT : STOP_BREAKPOINT;
+		}
+	}
+	else {
+		// instructions that end the batch early (a fault, a draw when asked to stop on them) set pendingStop
+		while (run.executed < count && pendingStop == STOP_BUDGET) {
+			uint8_t kind = FUSE_NONE;
+
+			if (fusionEnabled && !tracer && program_counter < MEMORY_SIZE) {
+				// most instructions can't start a superinstruction, which the decode table already tells
+				uint16_t first = (memory[program_counter] << 8u) | memory[(program_counter + 1) & ADDRESS_MASK];
+				if ((fusionHeads >> dispatch.decode[first]) & 1u) {
+					kind = DecodeFusion(program_counter);
+				}
+			}
+
+			// only fuse when the whole sequence fits in the remaining budget
+			if (kind != FUSE_NONE && FUSION_LENGTH[kind] <= count - run.executed) {
+				run.executed += RunFused(kind, count - run.executed);
+			}
+			else if (tracer) {
+				TracedStep();
+				++run.executed;
+			}
+			else {
+				Step();
+				++run.executed;
+			}
+		}
+	}
+
+	if (pendingStop != STOP_BUDGET) {
+		run.stop = pendingStop;
+		pendingStop = STOP_BUDGET;
+	}
+
+	// a batch that ended re-executing Fx0A will keep doing so until a key goes down
+	if (run.stop == STOP_BUDGET && run.executed > 0 && (opcode & 0xF0FFu) == 0xF00Au) {
+		unsigned int idleInstructions;
+		if (Waiting(idleInstructions) == WAIT_KEY) {
+			run.stop = STOP_KEY_WAIT;
+		}
+	}
+
+	frameCycles = (frameCycles + run.executed % cyclesPerFrame) % cyclesPerFrame;
+	return run;
+}
+
+// Function to run the rest of the current frame
+Chip8Run Chip8::RunUntilFrame()
+{
+	Chip8Run run = RunCycles(cyclesPerFrame - frameCycles);
+
+	if (run.stop == STOP_BUDGET) {
+		run.stop = STOP_FRAME;
+	}
+
+	return run;
+}
+
+// Function to set the length of a frame and start a new one
+void Chip8::SetCyclesPerFrame(unsigned int cycles)
+{
+	cyclesPerFrame = static_cast<uint16_t>(std::min(std::max(cycles, 1u), 0xFFFFu));
+	frameCycles = 0;
+}
@@ -4,6 +4,8 @@
 //
 // *********************************************************
 
+#pragma once
+
 // Libraries
 #include <iostream>
 #include <fstream>
@@ -20,8 +22,56 @@ const unsigned int STACK_LEVELS = 16;
 const unsigned int VIDEO_HEIGHT = 32;
 const unsigned int VIDEO_WIDTH = 64;
 
+// Every guest address is masked to 12 bits, so a ROM can't reach outside memory whatever I or the PC hold
+const unsigned int ADDRESS_MASK = MEMORY_SIZE - 1;
+
+// Memory is tracked in 256-byte pages for cloning, see TakeDirtyPages
+const unsigned int MEMORY_PAGE_SIZE = 256;
+const unsigned int MEMORY_PAGES = MEMORY_SIZE / MEMORY_PAGE_SIZE;
+
+// instructions in an emulated frame unless SetCyclesPerFrame says otherwise
+const unsigned int DEFAULT_CYCLES_PER_FRAME = 10;
+
+// Faults that stop the machine, it stays on the faulting instruction until reloaded
+enum Chip8Fault : uint8_t {
+	FAULT_NONE,
+	FAULT_STACK_OVERFLOW,	// 2nnn with all stack levels in use
+	FAULT_STACK_UNDERFLOW	// 00EE with an empty stack
+};
+
+// What a machine stuck in an idle loop is waiting for, see Chip8::Waiting
+enum Chip8Wait : uint8_t {
+	WAIT_NONE,			// doing real work
+	WAIT_KEY,			// Fx0A with no key down
+	WAIT_DELAY_TIMER,	// polling the delay timer until it reaches a value
+	WAIT_HALTED			// jumping to itself, polling for a timer value it will never read, or faulted
+};
+
+// Why a batch of instructions from RunCycles or RunUntilFrame ended
+enum Chip8Stop : uint8_t {
+	STOP_BUDGET,		// ran every instruction it was given
+	STOP_FRAME,			// RunUntilFrame reached the end of the frame
+	STOP_KEY_WAIT,		// used up the batch in Fx0A with no key down, nothing happens until the keys change
+	STOP_DISPLAY,		// an instruction drew or cleared the screen, only with SetStopOnDisplay
+	STOP_BREAKPOINT,	// the attached debugger stopped it at a breakpoint, a watchpoint or after a step
+	STOP_FAULT			// the machine has faulted, see GetFault
+};
+
+// What a batch of instructions did
+struct Chip8Run {
+	Chip8Stop stop;
+	unsigned int executed;
+};
+
+class Debugger;
+class TraceRecorder;
+
 // Chip8 class
 class Chip8 {
+	// the debugger inspects and edits the machine state directly, the cloner copies it
+	friend class Debugger;
+	friend class Chip8Cloner;
+
 	public:
 
 		// Chip8 constructor
@@ -30,23 +80,118 @@ class Chip8 {
 		// Chip8 function to load in a given ROM from a filename
 		void LoadROM(char const* filename);
 
-		// Fetch, Decode, Execute
+		// Chip8 function to load a ROM from a buffer, bytes that don't fit in memory are dropped
+		void LoadROM(uint8_t const* data, size_t size);
+
+		// Fetch, Decode, Execute a single instruction, the same as RunCycles(1)
 		void Cycle();
 
-		uint32_t display[VIDEO_WIDTH * VIDEO_HEIGHT]{};	// 32-bit display for output
-		uint8_t keys[KEY_COUNT];						// 8-bit array for key inputs
+		// Runs up to count instructions in one tight loop, dispatching fused superinstructions where possible
+		// Returns why it stopped and how many instructions it executed
+		Chip8Run RunCycles(unsigned int count);
 
-	private:
+		// Runs the rest of the current emulated frame, stopping early for the same reasons as RunCycles
+		Chip8Run RunUntilFrame();
+
+		// Sets how many instructions make up a frame for RunUntilFrame, and starts a new frame
+		void SetCyclesPerFrame(unsigned int cycles);
+
+		// Makes RunCycles stop right after any instruction that changes the display
+		void SetStopOnDisplay(bool enabled) { stopOnDisplay = enabled; }
+
+		// Enables or disables superinstruction fusion and idle-loop skipping in RunCycles
+		void SetFusion(bool enabled);
+
+		// Routes RunCycles through debugger while it has breakpoints, watchpoints or a step pending
+		// (nullptr detaches it)
+		void AttachDebugger(Debugger* attached) { debugger = attached; }
+
+		// Records every instruction RunCycles executes to tracer, which turns fusion off while attached
+		// (nullptr detaches it)
+		void AttachTracer(TraceRecorder* attached) { tracer = attached; }
+
+		// Seeds the generator behind Cxkk so runs can be reproduced
+		void SeedRandom(uint32_t seed);
+
+		// Returns the fault that stopped the machine, FAULT_NONE while it is running
+		Chip8Fault GetFault() const { return fault; }
+
+		// Returns whether the buzzer should sound, while the sound timer is running
+		bool SoundActive() const { return soundTimer > 0; }
 
-		// random number generator components
-		std::default_random_engine randGen;
-		std::uniform_int_distribution<uint16_t> randByte; // FIX ME: changed from uint8_t to uint16_t due to error, why?
+		// Returns what the machine is idling on at the current PC. For WAIT_DELAY_TIMER idleInstructions
+		// is how many more instructions it will certainly spend polling, before anything else can happen
+		Chip8Wait Waiting(unsigned int& idleInstructions) const;
 
-		// Function Table Declarations
-		void Table0();
-		void Table8();
-		void TableE();
-		void TableF();
+		// Returns a bit per display row changed since the last call (bit 0 is the top row), and clears them
+		uint32_t TakeDirtyRows();
+
+		// Returns a bit per memory page written since the last call (bit 0 is 0x000-0x0FF), and clears them
+		uint16_t TakeDirtyPages();
+
+		// Returns a hash of the architectural state: registers, I, PC, the stack in use, timers, memory,
+		// display, fault and random generator. Machines that agree on it will run the same from here on
+		uint64_t StateHash() const;
+
+		// Read-only views of the machine state for tools
+		uint16_t GetProgramCounter() const { return program_counter; }
+		uint8_t ReadMemory(uint16_t address) const { return memory[address & 0x0FFFu]; }
+
+		// Expands the display to 32-bit pixels for hosts that present it, VIDEO_WIDTH per row,
+		// 0xFFFFFFFF for a lit pixel and 0 for a dark one
+		void RenderPixels(uint32_t* pixels) const;
+
+		uint64_t display[VIDEO_HEIGHT]{};	// a row per word, one bit per pixel, bit 63 is the leftmost
+		uint8_t keys[KEY_COUNT]{};						// 8-bit array for key inputs
+
+	private:
+
+		// Superinstruction kinds, decoded as each instruction is reached
+		enum FusionKind : uint8_t {
+			FUSE_NONE = 0,			// plain instruction, use the decode table
+			FUSE_ANNN_DXYN,			// set I, then draw
+			FUSE_6XKK_6XKK,			// two register loads
+			FUSE_7XKK_3XKK_1NNN,	// counting loop: add, compare, jump back
+			FUSE_FX07_3XKK,			// delay timer poll
+			FUSE_IDLE_DELAY,		// Fx07, 3xkk, 1nnn spinning on the delay timer
+			FUSE_IDLE_KEY,			// Fx0A waiting for a key press
+			FUSE_IDLE_HALT			// 1nnn jumping to itself
+		};
+
+		// Works out which superinstruction (if any) starts at address
+		uint8_t DecodeFusion(uint16_t address) const;
+
+		// Keeps the dirty pages in step with a write of up to a page at address
+		void MemoryWritten(unsigned int address, unsigned int length);
+
+		// Stops the machine on the current instruction
+		void Trap(Chip8Fault kind);
+
+		// Decrements the delay and sound timers, once per executed instruction
+		void TickTimers();
+
+		// Executes a fused sequence with at most budget instructions, returns how many it retired
+		unsigned int RunFused(uint8_t kind, unsigned int budget);
+
+		// Fetch, Decode, Execute with no checks, what every other way of running ends up calling
+		void Step();
+
+		// Step, then hands what the instruction did to the attached tracer
+		void TracedStep();
+
+		// What the decode table maps each opcode to, one per instruction
+		enum Instruction : uint8_t {
+			INSTR_NULL = 0,
+			INSTR_00E0, INSTR_00EE, INSTR_1nnn, INSTR_2nnn, INSTR_3xkk, INSTR_4xkk, INSTR_5xy0,
+			INSTR_6xkk, INSTR_7xkk, INSTR_8xy0, INSTR_8xy1, INSTR_8xy2, INSTR_8xy3, INSTR_8xy4,
+			INSTR_8xy5, INSTR_8xy6, INSTR_8xy7, INSTR_8xyE, INSTR_9xy0, INSTR_Annn, INSTR_Bnnn,
+			INSTR_Cxkk, INSTR_Dxyn, INSTR_Ex9E, INSTR_ExA1, INSTR_Fx07, INSTR_Fx0A, INSTR_Fx15,
+			INSTR_Fx18, INSTR_Fx1E, INSTR_Fx29, INSTR_Fx33, INSTR_Fx55, INSTR_Fx65,
+			INSTR_COUNT
+		};
+
+		// Works out which instruction a 16-bit opcode is, INSTR_NULL for anything undefined
+		static constexpr uint8_t DecodeInstruction(uint16_t opcode);
 
 		// INSTRUCTION SET FUNCTIONS
 
@@ -156,21 +301,38 @@ class Chip8 {
 		void OP_Fx65();
 
 		// Chip-8 emulator specfications as listed here: https://austinmorlan.com/posts/chip8_emulator/
-		uint8_t memory[MEMORY_SIZE]{};			// creates memory array composed of 8-bit elements
-		uint8_t registers[REGISTER_COUNT]{};	// creates 16 8-bit registers for the emulator
+		// Everything an instruction touches besides memory and the display shares one cache line,
+		// with the stack starting right after it
+		alignas(64) uint8_t registers[REGISTER_COUNT]{};	// creates 16 8-bit registers for the emulator
+		uint16_t index{};				// 16-bit index variable
+		uint16_t program_counter{};		// 16-bit program_counter variable
+		uint16_t opcode{};				// 16-bit opcode instruction
 		uint8_t stack_pointer{};		// 8-bit variable for stack pointer
 		uint8_t delayTimer{};			// 8-bit delay timer
 		uint8_t soundTimer{};			// 8-bit sound timer
-		uint16_t index{};				// 16-bit index variable
-		uint16_t program_counter{};		// 16-bit program_counter variable
+		Chip8Fault fault{ FAULT_NONE };
+		bool fusionEnabled{ true };
+		bool displayBlank{ true };			// nothing drawn since the last clear
+		Chip8Stop pendingStop{ STOP_BUDGET };	// set by an instruction that ends the current batch
+		bool stopOnDisplay{ false };
+		uint16_t cyclesPerFrame{ DEFAULT_CYCLES_PER_FRAME };
+		uint16_t frameCycles{};			// instructions already run in the current frame
+		uint16_t dirtyPages{ 0xFFFFu };	// memory pages written since TakeDirtyPages, all at start
+		uint32_t dirtyRows{ 0xFFFFFFFFu };	// display rows changed since TakeDirtyRows, all at start
+		Debugger* debugger{};
+		TraceRecorder* tracer{};
+		std::minstd_rand randGen;		// random number generator for Cxkk, a single word of state
 		uint16_t stack[STACK_LEVELS]{};	// creates 16-bit memory stack array
-		uint16_t opcode;				// 16-bit opcode instruction
-		
-		// Function Pointer Tables and Ranges
-		typedef void (Chip8::* Chip8Func)();
-		Chip8Func table[0xF + 1]{ &Chip8::OP_NULL };
-		Chip8Func table0[0xE + 1]{ &Chip8::OP_NULL };
-		Chip8Func table8[0xE + 1]{ &Chip8::OP_NULL };
-		Chip8Func tableE[0xE + 1]{ &Chip8::OP_NULL };
-		Chip8Func tableF[0x65 + 1]{ &Chip8::OP_NULL };
+
+		alignas(64) uint8_t memory[MEMORY_SIZE]{};	// creates memory array composed of 8-bit elements
+
+		// Decode Table, shared by every instance and built at compile time. Every 16-bit opcode has its
+		// own entry, so an instruction is resolved in one lookup and no two opcodes can share a handler by
+		// accident. Step switches on the entry, which lets the compiler inline the handlers into a single
+		// jump table; calling through a table of member pointers ran at half the speed
+		struct DispatchTables {
+			uint8_t decode[0x10000];
+		};
+		static constexpr DispatchTables BuildDispatch();
+		static const DispatchTables dispatch;
 };
\ No newline at end of file
@@ -0,0 +1,362 @@
+// *********************************************************
+//
+//				  BATCHED ENVIRONMENT C API
+//
+// *********************************************************
+
+// Libraries
+#include "chip8env.h"
+#include "chip8.h"
+#include "pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// most memory bytes an environment can watch
+const uint32_t ENV_MAX_WATCHED = 256;
+
+// bytes per display row in an observation
+const unsigned int ENV_ROW_BYTES = VIDEO_WIDTH / 8;
+
+static_assert(CHIP8_ENV_OBSERVATION_BYTES == ENV_ROW_BYTES * VIDEO_HEIGHT, "observation layout doesn't match the display");
+
+// The batch behind the C handle. Each worker owns a fixed, contiguous range of environments, so a
+// machine and its slices of the output buffers are only ever touched by the same thread.
+struct chip8_env
+{
+	// every reset copies this machine, with the ROM already loaded
+	unique_ptr<Chip8> pristine;
+	uint32_t count{};
+
+	Chip8Pool pool;
+	vector<Chip8*> machines;
+
+	vector<uint8_t> observations;
+	vector<uint8_t> memory;
+	vector<uint8_t> faults;
+	vector<uint16_t> watched;
+
+	// worker 0 is the calling thread, the rest wait for a new generation of work
+	vector<thread> workers;
+	mutex lock;
+	condition_variable wake;
+	condition_variable finished;
+	function<void(uint32_t, uint32_t)> job;
+	uint64_t generation{};
+	unsigned int pending{};
+	bool stopping{};
+
+	~chip8_env();
+
+	// runs job over every environment, split between the workers, and returns once all are done
+	void RunParallel(function<void(uint32_t, uint32_t)> work);
+
+	// the environments worker handles, [begin, end)
+	void Range(unsigned int worker, uint32_t& begin, uint32_t& end) const;
+
+	// waits for work and runs its range of it until the batch is destroyed
+	void WorkerLoop(unsigned int worker);
+
+	// restarts one environment from the ROM and refreshes its outputs
+	void ResetOne(uint32_t env, uint32_t seed);
+
+	// copies the display rows changed since the last call into the environment's observation
+	void PackObservation(uint32_t env);
+
+	// copies the watched memory bytes and the fault out of the environment's machine
+	void ReadOutputs(uint32_t env);
+};
+
+// Function to stop the workers and give the machines back to the pool
+chip8_env::~chip8_env()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	for (Chip8* machine : machines) {
+		pool.Release(machine);
+	}
+}
+
+// Function to split the batch evenly, the first count % workers ranges taking one extra
+void chip8_env::Range(unsigned int worker, uint32_t& begin, uint32_t& end) const
+{
+	uint32_t threads = static_cast<uint32_t>(workers.size() + 1);
+	uint32_t share = count / threads;
+	uint32_t extra = count % threads;
+
+	begin = worker * share + std::min(worker, extra);
+	end = begin + share + (worker < extra ? 1 : 0);
+}
+
+// Function to hand a job to every worker and run the calling thread's own range of it
+void chip8_env::RunParallel(function<void(uint32_t, uint32_t)> work)
+{
+	uint32_t begin, end;
+
+	if (!workers.empty()) {
+		lock_guard<mutex> guard(lock);
+		job = std::move(work);
+		pending = static_cast<unsigned int>(workers.size());
+		++generation;
+	}
+	else {
+		job = std::move(work);
+	}
+	wake.notify_all();
+
+	Range(0, begin, end);
+	job(begin, end);
+
+	unique_lock<mutex> guard(lock);
+	finished.wait(guard, [this] { return pending == 0; });
+}
+
+// Function run by each worker thread
+void chip8_env::WorkerLoop(unsigned int worker)
+{
+	uint64_t seen = 0;
+
+	for (;;) {
+		{
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [&] { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+		}
+
+		uint32_t begin, end;
+		Range(worker, begin, end);
+		job(begin, end);
+
+		{
+			lock_guard<mutex> guard(lock);
+			--pending;
+		}
+		finished.notify_one();
+	}
+}
+
+// Function to restart an environment from a freshly loaded machine
+void chip8_env::ResetOne(uint32_t env, uint32_t seed)
+{
+	Chip8* machine = machines[env];
+
+	// a flat copy, the same as the fuzzer starts each input from
+	*machine = *pristine;
+	machine->SeedRandom(seed);
+
+	// the display starts clear, so does the observation
+	machine->TakeDirtyRows();
+	memset(&observations[static_cast<size_t>(env) * CHIP8_ENV_OBSERVATION_BYTES], 0, CHIP8_ENV_OBSERVATION_BYTES);
+
+	ReadOutputs(env);
+}
+
+// Function to pack the changed display rows at one bit per pixel
+void chip8_env::PackObservation(uint32_t env)
+{
+	Chip8* machine = machines[env];
+	uint8_t* observation = &observations[static_cast<size_t>(env) * CHIP8_ENV_OBSERVATION_BYTES];
+
+	uint32_t dirtyRows = machine->TakeDirtyRows();
+
+	while (dirtyRows) {
+		unsigned int row = 0;
+		while (!(dirtyRows & (1u << row))) {
+			++row;
+		}
+		dirtyRows &= ~(1u << row);
+
+		// stored big-endian, so the leftmost pixel lands in the top bit of the row's first byte
+		uint64_t bits = machine->display[row];
+		uint8_t* out = observation + row * ENV_ROW_BYTES;
+		for (unsigned int byte = 0; byte < ENV_ROW_BYTES; ++byte) {
+			out[byte] = static_cast<uint8_t>(bits >> (56 - byte * 8));
+		}
+	}
+}
+
+// Function to copy out what the caller reads besides the display
+void chip8_env::ReadOutputs(uint32_t env)
+{
+	Chip8 const* machine = machines[env];
+	uint8_t* out = memory.data() + static_cast<size_t>(env) * watched.size();
+
+	for (size_t i = 0; i < watched.size(); ++i) {
+		out[i] = machine->ReadMemory(watched[i]);
+	}
+
+	faults[env] = static_cast<uint8_t>(machine->GetFault());
+}
+
+extern "C" {
+
+uint32_t chip8_env_abi_version(void)
+{
+	return CHIP8_ENV_ABI_VERSION;
+}
+
+chip8_env* chip8_env_create_from_memory(uint8_t const* rom, size_t size, uint32_t count, uint32_t threads)
+{
+	if (rom == nullptr || size == 0 || count == 0) {
+		return nullptr;
+	}
+
+	chip8_env* env = new (nothrow) chip8_env();
+	if (env == nullptr) {
+		return nullptr;
+	}
+
+	// no exception may cross the C boundary, running out of memory just fails the call
+	try {
+		env->pristine = make_unique<Chip8>();
+		env->pristine->LoadROM(rom, size);
+		env->pristine->TakeDirtyRows();
+		env->count = count;
+
+		env->machines.reserve(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			env->machines.push_back(env->pool.Acquire());
+		}
+
+		env->observations.assign(static_cast<size_t>(count) * CHIP8_ENV_OBSERVATION_BYTES, 0);
+		env->faults.assign(count, 0);
+
+		if (threads == 0) {
+			threads = std::max(1u, thread::hardware_concurrency());
+		}
+		threads = std::min(threads, count);
+
+		for (unsigned int worker = 1; worker < threads; ++worker) {
+			env->workers.emplace_back(&chip8_env::WorkerLoop, env, worker);
+		}
+	}
+	catch (...) {
+		delete env;
+		return nullptr;
+	}
+
+	chip8_env_reset(env, nullptr, nullptr);
+	return env;
+}
+
+chip8_env* chip8_env_create(char const* rom_path, uint32_t count, uint32_t threads)
+{
+	if (rom_path == nullptr) {
+		return nullptr;
+	}
+
+	ifstream file(rom_path, ios::binary);
+	if (!file.is_open()) {
+		return nullptr;
+	}
+
+	vector<uint8_t> rom((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	return chip8_env_create_from_memory(rom.data(), rom.size(), count, threads);
+}
+
+void chip8_env_destroy(chip8_env* env)
+{
+	delete env;
+}
+
+uint32_t chip8_env_count(chip8_env const* env)
+{
+	return env->count;
+}
+
+void chip8_env_set_cycles_per_frame(chip8_env* env, uint32_t cycles)
+{
+	env->pristine->SetCyclesPerFrame(cycles);
+
+	for (Chip8* machine : env->machines) {
+		machine->SetCyclesPerFrame(cycles);
+	}
+}
+
+void chip8_env_reset(chip8_env* env, uint32_t const* seeds, uint8_t const* mask)
+{
+	env->RunParallel([env, seeds, mask](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			if (mask == nullptr || mask[i] != 0) {
+				env->ResetOne(i, seeds != nullptr ? seeds[i] : i);
+			}
+		}
+	});
+}
+
+void chip8_env_step(chip8_env* env, uint16_t const* actions, uint32_t frames)
+{
+	env->RunParallel([env, actions, frames](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Chip8* machine = env->machines[i];
+
+			uint16_t action = actions != nullptr ? actions[i] : 0;
+			for (unsigned int key = 0; key < KEY_COUNT; ++key) {
+				machine->keys[key] = static_cast<uint8_t>((action >> key) & 1);
+			}
+
+			for (uint32_t frame = 0; frame < frames; ++frame) {
+				if (machine->RunUntilFrame().stop == STOP_FAULT) {
+					break;
+				}
+			}
+
+			env->PackObservation(i);
+			env->ReadOutputs(i);
+		}
+	});
+}
+
+void chip8_env_watch_memory(chip8_env* env, uint16_t const* addresses, uint32_t count)
+{
+	count = std::min(count, ENV_MAX_WATCHED);
+	if (addresses == nullptr) {
+		count = 0;
+	}
+
+	env->watched.assign(addresses, addresses + count);
+	env->memory.assign(static_cast<size_t>(env->count) * count, 0);
+
+	// filled in now, so the values are there before the next step
+	for (uint32_t i = 0; i < env->count; ++i) {
+		env->ReadOutputs(i);
+	}
+}
+
+uint8_t const* chip8_env_observations(chip8_env const* env)
+{
+	return env->observations.data();
+}
+
+uint8_t const* chip8_env_memory(chip8_env const* env)
+{
+	return env->memory.data();
+}
+
+uint8_t const* chip8_env_faults(chip8_env const* env)
+{
+	return env->faults.data();
+}
+
+}
@@ -0,0 +1,83 @@
+/* *********************************************************
+ *
+ *		  BATCHED ENVIRONMENT C API
+ *
+ * ********************************************************* */
+
+/* A stable C interface to a batch of machines all running one ROM, for agents and training loops.
+ * Every environment steps by whole frames with its keys held as given, the batch is split over a
+ * pool of worker threads, and results are written straight into buffers the caller reads in place:
+ *   observations  count * CHIP8_ENV_OBSERVATION_BYTES, the display at one bit per pixel, rows top to
+ *                 bottom, 8 bytes per row, the leftmost pixel in the top bit of the first byte
+ *   memory        count * watched bytes, the memory addresses chosen with chip8_env_watch_memory,
+ *                 for reading scores and lives out of a game
+ *   faults        count bytes, non-zero once an environment's machine has faulted (a Chip8Fault)
+ * The pointers stay valid until chip8_env_destroy, except the memory one which chip8_env_watch_memory
+ * replaces, and the contents change only during reset and step.
+ * None of the functions may be called on the same batch from two threads at once. */
+
+#ifndef CHIP8_ENV_H
+#define CHIP8_ENV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CHIP8_ENV_STATIC compiles the API straight into a program, as the Visual Studio tools project does */
+#if defined(CHIP8_ENV_STATIC)
+	#define CHIP8_ENV_API
+#elif defined(_WIN32)
+	#if defined(CHIP8_ENV_BUILD)
+		#define CHIP8_ENV_API __declspec(dllexport)
+	#else
+		#define CHIP8_ENV_API __declspec(dllimport)
+	#endif
+#else
+	#define CHIP8_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bumped whenever a signature or a buffer layout changes */
+#define CHIP8_ENV_ABI_VERSION 1
+
+#define CHIP8_ENV_OBSERVATION_BYTES 256
+
+typedef struct chip8_env chip8_env;
+
+CHIP8_ENV_API uint32_t chip8_env_abi_version(void);
+
+/* creates count environments running a ROM from a file or a buffer, reset with seeds 0 to count - 1.
+ * threads 0 uses one worker per hardware thread. Returns NULL if the ROM can't be read */
+CHIP8_ENV_API chip8_env* chip8_env_create(char const* rom_path, uint32_t count, uint32_t threads);
+CHIP8_ENV_API chip8_env* chip8_env_create_from_memory(uint8_t const* rom, size_t size, uint32_t count, uint32_t threads);
+
+CHIP8_ENV_API void chip8_env_destroy(chip8_env* env);
+
+CHIP8_ENV_API uint32_t chip8_env_count(chip8_env const* env);
+
+/* instructions per frame for every environment, 10 by default, each one starts a new frame */
+CHIP8_ENV_API void chip8_env_set_cycles_per_frame(chip8_env* env, uint32_t cycles);
+
+/* restarts environments from the loaded ROM with their random generators seeded from seeds.
+ * seeds is count values, or NULL to reset every environment with its index. mask, when not NULL,
+ * is count bytes and only environments with a non-zero byte are reset */
+CHIP8_ENV_API void chip8_env_reset(chip8_env* env, uint32_t const* seeds, uint8_t const* mask);
+
+/* runs every environment for frames frames. actions is count key masks, bit k set holds key k down
+ * for the whole step. Faulted environments stay as they are until reset */
+CHIP8_ENV_API void chip8_env_step(chip8_env* env, uint16_t const* actions, uint32_t frames);
+
+/* chooses the memory bytes copied out after every reset and step, up to 256 addresses */
+CHIP8_ENV_API void chip8_env_watch_memory(chip8_env* env, uint16_t const* addresses, uint32_t count);
+
+CHIP8_ENV_API uint8_t const* chip8_env_observations(chip8_env const* env);
+CHIP8_ENV_API uint8_t const* chip8_env_memory(chip8_env const* env);
+CHIP8_ENV_API uint8_t const* chip8_env_faults(chip8_env const* env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
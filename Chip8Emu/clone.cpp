@@ -0,0 +1,103 @@
+// *********************************************************
+//
+//			  COPY-ON-WRITE CLONES FOR STATE SEARCH
+//
+// *********************************************************
+
+// header inclusion
+#include "clone.h"
+#include <cstring>
+
+using namespace std;
+
+// Function to count the pages two clones hold separate copies of
+unsigned int Chip8Clone::PagesDifferentFrom(Chip8Clone const& other) const
+{
+	unsigned int different = 0;
+
+	for (unsigned int page = 0; page < MEMORY_PAGES; ++page) {
+		if (pages[page] != other.pages[page]) {
+			++different;
+		}
+	}
+
+	return different;
+}
+
+// Cloner constructor declaration
+Chip8Cloner::Chip8Cloner(Chip8 const& root)
+	: machine(std::make_unique<Chip8>(root))
+{
+	// nothing is shared yet, so the first clone copies every page
+	machine->dirtyPages = 0xFFFFu;
+}
+
+// Function to freeze the working machine, copying only the pages it wrote
+shared_ptr<Chip8Clone const> Chip8Cloner::Clone()
+{
+	shared_ptr<Chip8Clone> clone = make_shared<Chip8Clone>();
+	uint16_t written = machine->TakeDirtyPages();
+
+	for (unsigned int page = 0; page < MEMORY_PAGES; ++page) {
+		if ((written >> page) & 1u) {
+			shared_ptr<MemoryPage> copy = make_shared<MemoryPage>();
+			memcpy(copy->bytes, machine->memory + page * MEMORY_PAGE_SIZE, MEMORY_PAGE_SIZE);
+			pages[page] = std::move(copy);
+			++pagesCloned;
+		}
+		clone->pages[page] = pages[page];
+	}
+
+	memcpy(clone->rows, machine->display, sizeof(clone->rows));
+
+	memcpy(clone->registers, machine->registers, sizeof(clone->registers));
+	clone->index = machine->index;
+	clone->program_counter = machine->program_counter;
+	clone->opcode = machine->opcode;
+	clone->stack_pointer = machine->stack_pointer;
+	clone->delayTimer = machine->delayTimer;
+	clone->soundTimer = machine->soundTimer;
+	clone->fault = machine->fault;
+	clone->displayBlank = machine->displayBlank;
+	clone->cyclesPerFrame = machine->cyclesPerFrame;
+	clone->frameCycles = machine->frameCycles;
+	clone->randGen = machine->randGen;
+	memcpy(clone->stack, machine->stack, sizeof(clone->stack));
+	memcpy(clone->keys, machine->keys, sizeof(clone->keys));
+
+	return clone;
+}
+
+// Function to continue the working machine from a clone
+void Chip8Cloner::Restore(Chip8Clone const& clone)
+{
+	// a page is already right if the machine holds the same shared page and hasn't written it since
+	uint16_t written = machine->TakeDirtyPages();
+
+	for (unsigned int page = 0; page < MEMORY_PAGES; ++page) {
+		if (((written >> page) & 1u) || pages[page] != clone.pages[page]) {
+			memcpy(machine->memory + page * MEMORY_PAGE_SIZE, clone.pages[page]->bytes, MEMORY_PAGE_SIZE);
+			pages[page] = clone.pages[page];
+			++pagesRestored;
+		}
+	}
+
+	memcpy(machine->display, clone.rows, sizeof(clone.rows));
+	machine->dirtyRows = 0xFFFFFFFFu;
+
+	memcpy(machine->registers, clone.registers, sizeof(clone.registers));
+	machine->index = clone.index;
+	machine->program_counter = clone.program_counter;
+	machine->opcode = clone.opcode;
+	machine->stack_pointer = clone.stack_pointer;
+	machine->delayTimer = clone.delayTimer;
+	machine->soundTimer = clone.soundTimer;
+	machine->fault = clone.fault;
+	machine->displayBlank = clone.displayBlank;
+	machine->pendingStop = STOP_BUDGET;
+	machine->cyclesPerFrame = clone.cyclesPerFrame;
+	machine->frameCycles = clone.frameCycles;
+	machine->randGen = clone.randGen;
+	memcpy(machine->stack, clone.stack, sizeof(clone.stack));
+	memcpy(machine->keys, clone.keys, sizeof(clone.keys));
+}
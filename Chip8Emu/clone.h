@@ -0,0 +1,85 @@
+#pragma once
+#include "chip8.h"
+#include <memory>
+
+// One page of guest memory, never written again once a clone holds it
+struct MemoryPage {
+	uint8_t bytes[MEMORY_PAGE_SIZE];
+};
+
+// A machine state frozen for state-space search, made and run by Chip8Cloner. Memory is held as
+// shared, read-only pages, so a clone only owns its CPU state and a packed copy of the display, and
+// every page it didn't write is the same page object as in the clone it was run from.
+class Chip8Clone
+{
+	friend class Chip8Cloner;
+
+	public:
+		// pages not shared with the clone at the same index of other, for reporting how much is shared
+		unsigned int PagesDifferentFrom(Chip8Clone const& other) const;
+
+		uint16_t GetProgramCounter() const { return program_counter; }
+		Chip8Fault GetFault() const { return fault; }
+
+		// the display as rows of one bit per pixel, bit 63 is the leftmost pixel
+		uint64_t const* Rows() const { return rows; }
+
+	private:
+		std::shared_ptr<MemoryPage const> pages[MEMORY_PAGES];
+		uint64_t rows[VIDEO_HEIGHT];
+
+		// the architectural state, as in Chip8
+		uint8_t registers[REGISTER_COUNT];
+		uint16_t index;
+		uint16_t program_counter;
+		uint16_t opcode;
+		uint8_t stack_pointer;
+		uint8_t delayTimer;
+		uint8_t soundTimer;
+		Chip8Fault fault;
+		bool displayBlank;
+		uint16_t cyclesPerFrame;
+		uint16_t frameCycles;
+		std::minstd_rand randGen;
+		uint16_t stack[STACK_LEVELS];
+		uint8_t keys[KEY_COUNT];
+};
+
+// Clones a working machine and restores clones into it, sharing memory copy-on-write at page
+// granularity. Cloning makes new page copies only of the pages the machine wrote (through Fx33,
+// Fx55 or the debugger) since it was last cloned or restored; the rest are shared with the clone
+// it came from. Restoring copies only the pages that differ from what the machine already holds.
+// Clones are independent and deterministic: restoring one and running it always gives the same
+// result, whatever was run from it or from its relatives before.
+// The machine's fusion, stop-on-display, debugger and tracer settings stay with the machine.
+class Chip8Cloner
+{
+	public:
+		// starts with a copy of root as the working machine
+		explicit Chip8Cloner(Chip8 const& root);
+
+		Chip8Cloner(Chip8Cloner const&) = delete;
+		Chip8Cloner& operator=(Chip8Cloner const&) = delete;
+
+		// the working machine, run it between Restore and Clone
+		Chip8& Machine() { return *machine; }
+
+		// freezes the working machine as it is now
+		std::shared_ptr<Chip8Clone const> Clone();
+
+		// makes the working machine continue from clone
+		void Restore(Chip8Clone const& clone);
+
+		// pages copied out of the machine by Clone and into it by Restore, since construction
+		uint64_t PagesCloned() const { return pagesCloned; }
+		uint64_t PagesRestored() const { return pagesRestored; }
+
+	private:
+		std::unique_ptr<Chip8> machine;
+
+		// the page each of the machine's memory pages matches, unless it was written since
+		std::shared_ptr<MemoryPage const> pages[MEMORY_PAGES];
+
+		uint64_t pagesCloned{};
+		uint64_t pagesRestored{};
+};
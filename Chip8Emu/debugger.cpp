@@ -0,0 +1,189 @@
+// *********************************************************
+//
+//			   CHIP 8 DEBUGGER
+//
+// *********************************************************
+
+// header inclusion
+#include "debugger.h"
+#include <algorithm>
+
+using namespace std;
+
+// Function to set or clear a breakpoint
+void Debugger::SetBreakpoint(uint16_t address, bool enabled)
+{
+	address &= 0x0FFFu;
+
+	if (breakpoints[address] != enabled) {
+		breakpoints[address] = enabled;
+		breakpointCount += enabled ? 1 : -1;
+	}
+}
+
+// Function to watch a memory range
+void Debugger::AddWatchpoint(uint16_t address, uint16_t length, uint8_t kind)
+{
+	watchpoints.push_back({ address, length, kind });
+}
+
+// Function to stop watching a memory range
+void Debugger::RemoveWatchpoint(uint16_t address, uint16_t length, uint8_t kind)
+{
+	for (auto watch = watchpoints.begin(); watch != watchpoints.end(); ++watch) {
+		if (watch->address == address && watch->length == length && watch->kind == kind) {
+			watchpoints.erase(watch);
+			return;
+		}
+	}
+}
+
+// Function to check the memory the instruction opcode accesses against the watchpoints
+bool Debugger::HitsWatchpoint(Chip8 const& chip8, uint16_t opcode)
+{
+	// work out the accessed range from the instruction itself, which the core wraps at the end of memory
+	unsigned int first = chip8.index & ADDRESS_MASK;
+	unsigned int length = 0;
+	uint8_t kind = 0;
+	uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+	if ((opcode & 0xF000u) == 0xD000u) {
+		length = opcode & 0x000Fu;
+		kind = WATCH_READ;
+	}
+	else if ((opcode & 0xF0FFu) == 0xF033u) {
+		length = 3;
+		kind = WATCH_WRITE;
+	}
+	else if ((opcode & 0xF0FFu) == 0xF055u) {
+		length = x + 1u;
+		kind = WATCH_WRITE;
+	}
+	else if ((opcode & 0xF0FFu) == 0xF065u) {
+		length = x + 1u;
+		kind = WATCH_READ;
+	}
+
+	if (length == 0) {
+		return false;
+	}
+
+	// both ranges wrap at the end of memory: they overlap when either starts inside the other
+	for (Watchpoint const& watch : watchpoints) {
+		bool watchInAccess = ((watch.address - first) & ADDRESS_MASK) < length;
+		bool accessInWatch = ((first - watch.address) & ADDRESS_MASK) < watch.length;
+
+		if ((watch.kind & kind) && (watchInAccess || accessInWatch)) {
+			watchAddress = static_cast<uint16_t>((watchInAccess ? watch.address : first) & ADDRESS_MASK);
+			watchKind = watch.kind;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Function to run instructions one at a time, checking each against the breakpoints and watchpoints
+unsigned int Debugger::Run(Chip8& chip8, unsigned int count)
+{
+	unsigned int executed = 0;
+	lastStop = DEBUG_NONE;
+
+	while (executed < count) {
+		uint16_t pc = chip8.program_counter;
+
+		// a faulted machine stays on the faulting instruction
+		if (chip8.fault != FAULT_NONE) {
+			lastStop = DEBUG_FAULT;
+			return executed;
+		}
+
+		// stop before the instruction, unless resuming from this very breakpoint
+		if (breakpoints[pc & 0x0FFFu] && !(executed == 0 && resumeFrom == pc)) {
+			lastStop = DEBUG_BREAKPOINT;
+			resumeFrom = pc;
+			return executed;
+		}
+		resumeFrom = -1;
+
+		// the accessed range depends on I before the instruction runs
+		uint16_t opcode = (chip8.memory[pc & 0x0FFFu] << 8u) | chip8.memory[(pc + 1) & 0x0FFFu];
+		bool watched = !watchpoints.empty() && HitsWatchpoint(chip8, opcode);
+
+		if (chip8.tracer) {
+			chip8.TracedStep();
+		}
+		else {
+			chip8.Step();
+		}
+		++executed;
+
+		if (watched) {
+			lastStop = DEBUG_WATCHPOINT;
+			return executed;
+		}
+
+		if (stepping) {
+			stepping = false;
+			lastStop = DEBUG_STEP;
+			return executed;
+		}
+
+		// the instruction ended the batch for the machine itself (a fault, or a draw it was told to stop on)
+		if (chip8.pendingStop != STOP_BUDGET) {
+			return executed;
+		}
+	}
+
+	return executed;
+}
+
+// Function to read the architectural registers
+Debugger::Registers Debugger::ReadRegisters(Chip8 const& chip8)
+{
+	Registers registers;
+
+	for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+		registers.v[i] = chip8.registers[i];
+	}
+	registers.index = chip8.index;
+	registers.pc = chip8.program_counter;
+	registers.sp = chip8.stack_pointer;
+	registers.delay = chip8.delayTimer;
+	registers.sound = chip8.soundTimer;
+
+	return registers;
+}
+
+// Function to overwrite the architectural registers
+void Debugger::WriteRegisters(Chip8& chip8, Registers const& registers)
+{
+	for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+		chip8.registers[i] = registers.v[i];
+	}
+	chip8.index = registers.index;
+	chip8.program_counter = registers.pc;
+	chip8.stack_pointer = registers.sp;
+	chip8.delayTimer = registers.delay;
+	chip8.soundTimer = registers.sound;
+}
+
+// Function to read a return address from the call stack
+uint16_t Debugger::StackEntry(Chip8 const& chip8, unsigned int level)
+{
+	return level < STACK_LEVELS ? chip8.stack[level] : 0;
+}
+
+// Function to read a byte of memory
+uint8_t Debugger::ReadMemory(Chip8 const& chip8, uint16_t address)
+{
+	return chip8.memory[address & 0x0FFFu];
+}
+
+// Function to patch a byte of memory, keeping the dirty pages coherent
+void Debugger::WriteMemory(Chip8& chip8, uint16_t address, uint8_t value)
+{
+	address &= 0x0FFFu;
+	chip8.memory[address] = value;
+	chip8.MemoryWritten(address, 1);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "chip8.h"
+#include <bitset>
+#include <vector>
+
+// Why the last Debugger::Run returned early
+enum DebugStop : uint8_t {
+	DEBUG_NONE,			// ran the whole budget
+	DEBUG_BREAKPOINT,	// about to execute a breakpoint address
+	DEBUG_WATCHPOINT,	// the last instruction touched a watched memory range
+	DEBUG_STEP,			// finished a single step
+	DEBUG_FAULT			// the machine has faulted and won't go any further
+};
+
+// Kinds of memory access a watchpoint triggers on
+const uint8_t WATCH_WRITE = 1;
+const uint8_t WATCH_READ = 2;
+const uint8_t WATCH_ACCESS = WATCH_WRITE | WATCH_READ;
+
+// Breakpoints on the program counter, watchpoints on memory ranges and single stepping.
+// Attached with Chip8::AttachDebugger; while nothing is set RunCycles keeps its normal fast path,
+// so the only cost of an idle debugger is one check per batch.
+class Debugger
+{
+	public:
+		// Architectural registers as the debugger sees them
+		struct Registers {
+			uint8_t v[REGISTER_COUNT];
+			uint16_t index;
+			uint16_t pc;
+			uint8_t sp;
+			uint8_t delay;
+			uint8_t sound;
+		};
+
+		void SetBreakpoint(uint16_t address, bool enabled);
+		void AddWatchpoint(uint16_t address, uint16_t length, uint8_t kind);
+		void RemoveWatchpoint(uint16_t address, uint16_t length, uint8_t kind);
+
+		// makes the next Run execute a single instruction
+		void RequestStep() { stepping = true; }
+
+		// true while instructions need checking one at a time
+		bool Active() const { return stepping || breakpointCount > 0 || !watchpoints.empty(); }
+
+		// runs up to count instructions, stopping early at breakpoints, watchpoints and steps
+		unsigned int Run(Chip8& chip8, unsigned int count);
+
+		DebugStop LastStop() const { return lastStop; }
+		uint16_t WatchAddress() const { return watchAddress; }
+		uint8_t WatchKind() const { return watchKind; }
+
+		// state inspection and editing
+		static Registers ReadRegisters(Chip8 const& chip8);
+		static void WriteRegisters(Chip8& chip8, Registers const& registers);
+		static uint16_t StackEntry(Chip8 const& chip8, unsigned int level);
+		static uint8_t ReadMemory(Chip8 const& chip8, uint16_t address);
+		static void WriteMemory(Chip8& chip8, uint16_t address, uint8_t value);
+
+	private:
+		struct Watchpoint {
+			uint16_t address;
+			uint16_t length;
+			uint8_t kind;
+		};
+
+		// checks the accesses of the instruction at pc against the watchpoints
+		bool HitsWatchpoint(Chip8 const& chip8, uint16_t opcode);
+
+		std::bitset<MEMORY_SIZE> breakpoints;
+		unsigned int breakpointCount{};
+		std::vector<Watchpoint> watchpoints;
+
+		bool stepping{};
+		DebugStop lastStop{ DEBUG_NONE };
+		int resumeFrom{ -1 };		// breakpoint address we stopped at, passed over on the next Run
+		uint16_t watchAddress{};
+		uint8_t watchKind{};
+};
@@ -0,0 +1,36 @@
+// *********************************************************
+//
+//			   INCREMENTAL FRAMEBUFFER HASHING
+//
+// *********************************************************
+
+// header inclusion
+#include "framehash.h"
+
+// Function to refresh the dirty rows and hash the whole frame
+uint64_t FrameHasher::Update(uint64_t const* display, uint32_t dirtyRows)
+{
+	// only the changed rows are read from the display
+	while (dirtyRows) {
+		unsigned int row = 0;
+		while (!(dirtyRows & (1u << row))) {
+			++row;
+		}
+		dirtyRows &= ~(1u << row);
+
+		rows[row] = display[row];
+	}
+
+	// 64-bit FNV-1a style fold of the packed rows, with a final avalanche so similar frames differ
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		hash = (hash ^ rows[row]) * 0x100000001B3ull;
+		hash ^= hash >> 29;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+
+	return hash;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "chip8.h"
+
+// Hashes the 64x32 display incrementally: the rows are cached, so only the ones reported dirty by
+// Chip8::TakeDirtyRows are read from the display again.
+class FrameHasher
+{
+	public:
+		// folds the dirty rows of display (Chip8::display) into the cache and returns the hash of the whole frame
+		uint64_t Update(uint64_t const* display, uint32_t dirtyRows);
+
+		// the rows as of the last Update, one bit per pixel
+		uint64_t const* Rows() const { return rows; }
+
+	private:
+		uint64_t rows[VIDEO_HEIGHT]{};
+};
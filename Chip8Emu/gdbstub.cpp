@@ -0,0 +1,553 @@
+// *********************************************************
+//
+//			   GDB REMOTE SERIAL PROTOCOL STUB
+//
+// *********************************************************
+
+// header inclusion
+#include "gdbstub.h"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// instructions run between checks for an interrupt from the client while continuing
+const unsigned int GDB_RUN_BATCH = 10000;
+
+// how long a continue on a machine that can't make progress sleeps between checks for an interrupt
+const int GDB_IDLE_POLL_MS = 10;
+
+// number of registers in the g packet and target.xml
+const unsigned int GDB_REGISTER_COUNT = REGISTER_COUNT + 5;
+
+const char GDB_TARGET_XML[] =
+	"<?xml version=\"1.0\"?>"
+	"<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+	"<target version=\"1.0\"><feature name=\"org.chip8.core\">"
+	"<reg name=\"v0\" bitsize=\"8\" regnum=\"0\"/><reg name=\"v1\" bitsize=\"8\"/><reg name=\"v2\" bitsize=\"8\"/>"
+	"<reg name=\"v3\" bitsize=\"8\"/><reg name=\"v4\" bitsize=\"8\"/><reg name=\"v5\" bitsize=\"8\"/>"
+	"<reg name=\"v6\" bitsize=\"8\"/><reg name=\"v7\" bitsize=\"8\"/><reg name=\"v8\" bitsize=\"8\"/>"
+	"<reg name=\"v9\" bitsize=\"8\"/><reg name=\"va\" bitsize=\"8\"/><reg name=\"vb\" bitsize=\"8\"/>"
+	"<reg name=\"vc\" bitsize=\"8\"/><reg name=\"vd\" bitsize=\"8\"/><reg name=\"ve\" bitsize=\"8\"/>"
+	"<reg name=\"vf\" bitsize=\"8\"/>"
+	"<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/><reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+	"<reg name=\"sp\" bitsize=\"8\"/><reg name=\"dt\" bitsize=\"8\"/><reg name=\"st\" bitsize=\"8\"/>"
+	"</feature></target>";
+
+// Function to append bytes as hex digits
+static void PutHex(string& out, uint32_t value, unsigned int bytes)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	// registers go little endian, like every target gdb knows
+	for (unsigned int i = 0; i < bytes; ++i) {
+		uint8_t byte = static_cast<uint8_t>(value >> (8 * i));
+		out += digits[byte >> 4];
+		out += digits[byte & 0xF];
+	}
+}
+
+// Function to parse text[begin, end) as one hex number, false unless all of it is one that fits.
+// Everything in a packet comes from the client, so nothing here may throw
+static bool ParseHex(string const& text, size_t begin, size_t end, uint32_t& value)
+{
+	if (begin >= end || end > text.size()) {
+		return false;
+	}
+
+	char const* last = text.data() + end;
+	from_chars_result result = from_chars(text.data() + begin, last, value, 16);
+	return result.ec == errc() && result.ptr == last;
+}
+
+// Function to read a little-endian hex value of bytes bytes, false if the text is short or not hex
+static bool GetHex(string const& text, size_t pos, unsigned int bytes, uint32_t& value)
+{
+	value = 0;
+	for (unsigned int i = 0; i < bytes; ++i) {
+		uint32_t byte;
+		if (!ParseHex(text, pos + 2 * i, pos + 2 * i + 2, byte)) {
+			return false;
+		}
+		value |= byte << (8 * i);
+	}
+	return true;
+}
+
+// Function to read the value and width of register number from the debugger view
+static uint32_t RegisterValue(Debugger::Registers const& registers, unsigned int number, unsigned int& bytes)
+{
+	bytes = 1;
+	if (number < REGISTER_COUNT) {
+		return registers.v[number];
+	}
+
+	switch (number - REGISTER_COUNT) {
+	case 0: bytes = 2; return registers.index;
+	case 1: bytes = 2; return registers.pc;
+	case 2: return registers.sp;
+	case 3: return registers.delay;
+	default: return registers.sound;
+	}
+}
+
+// Function to write register number into the debugger view
+static void SetRegister(Debugger::Registers& registers, unsigned int number, uint32_t value)
+{
+	if (number < REGISTER_COUNT) {
+		registers.v[number] = static_cast<uint8_t>(value);
+		return;
+	}
+
+	switch (number - REGISTER_COUNT) {
+	case 0: registers.index = static_cast<uint16_t>(value); break;
+	case 1: registers.pc = static_cast<uint16_t>(value); break;
+	case 2: registers.sp = static_cast<uint8_t>(value); break;
+	case 3: registers.delay = static_cast<uint8_t>(value); break;
+	default: registers.sound = static_cast<uint8_t>(value); break;
+	}
+}
+
+// Stub constructor declaration
+GdbStub::GdbStub(Chip8& machine)
+	: chip8(machine)
+{
+	chip8.AttachDebugger(&debugger);
+}
+
+#ifdef __linux__
+
+// Function to wait for a client and serve it
+bool GdbStub::Serve(uint16_t port)
+{
+	int listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listener < 0) {
+		return false;
+	}
+
+	int yes = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 1) < 0) {
+		close(listener);
+		return false;
+	}
+
+	client = accept(listener, nullptr, nullptr);
+	close(listener);
+	if (client < 0) {
+		return false;
+	}
+	setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+	string packet;
+	while (ReadPacket(packet) && Handle(packet)) {
+	}
+
+	close(client);
+	client = -1;
+	chip8.AttachDebugger(nullptr);
+	return true;
+}
+
+// Function to read the next packet with a valid checksum, acknowledging it
+bool GdbStub::ReadPacket(string& packet)
+{
+	while (true) {
+		char byte;
+
+		// skip acks and anything else outside a packet, an interrupt while stopped is simply ignored
+		do {
+			if (recv(client, &byte, 1, 0) != 1) {
+				return false;
+			}
+		} while (byte != '$');
+
+		packet.clear();
+		uint8_t sum = 0;
+		while (true) {
+			if (recv(client, &byte, 1, 0) != 1) {
+				return false;
+			}
+			if (byte == '#') {
+				break;
+			}
+			packet += byte;
+			sum += static_cast<uint8_t>(byte);
+		}
+
+		char digits[2];
+		if (recv(client, digits, 2, MSG_WAITALL) != 2) {
+			return false;
+		}
+
+		// a corrupted packet is never acted on, the client sends it again after a '-'
+		uint32_t checksum;
+		bool valid = ParseHex(string(digits, 2), 0, 2, checksum) && checksum == sum;
+		if (send(client, valid ? "+" : "-", 1, MSG_NOSIGNAL) != 1) {
+			return false;
+		}
+		if (valid) {
+			return true;
+		}
+	}
+}
+
+// Function to send a packet with its checksum
+bool GdbStub::SendPacket(string const& payload)
+{
+	uint8_t sum = 0;
+	for (char c : payload) {
+		sum += static_cast<uint8_t>(c);
+	}
+
+	string packet = "$" + payload + "#";
+	PutHex(packet, sum, 1);
+
+	return send(client, packet.data(), packet.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(packet.size());
+}
+
+// Function to print text on the client console
+bool GdbStub::SendOutput(string const& text)
+{
+	string payload = "O";
+	for (char c : text) {
+		PutHex(payload, static_cast<uint8_t>(c), 1);
+	}
+	return SendPacket(payload);
+}
+
+// Function to continue or step until the machine stops or the client interrupts
+string GdbStub::Resume(bool step)
+{
+	interrupted = false;
+
+	if (step) {
+		debugger.RequestStep();
+		chip8.RunCycles(1);
+		return StopReply();
+	}
+
+	while (true) {
+		chip8.RunCycles(GDB_RUN_BATCH);
+		if ((debugger.LastStop() != DEBUG_NONE && debugger.Active()) || chip8.GetFault() != FAULT_NONE) {
+			return StopReply();
+		}
+
+		// a machine waiting for a key or halted runs each batch in no time without getting anywhere,
+		// so wait for the client instead of spinning
+		unsigned int idleInstructions;
+		Chip8Wait wait = chip8.Waiting(idleInstructions);
+		if (wait == WAIT_KEY || wait == WAIT_HALTED) {
+			pollfd readable = { client, POLLIN, 0 };
+			poll(&readable, 1, GDB_IDLE_POLL_MS);
+		}
+
+		// Ctrl-C in the client arrives as a lone 0x03 byte
+		char byte;
+		if (recv(client, &byte, 1, MSG_DONTWAIT) == 1 && byte == 0x03) {
+			interrupted = true;
+			return StopReply();
+		}
+	}
+}
+
+#else
+
+bool GdbStub::Serve(uint16_t) { return false; }
+bool GdbStub::ReadPacket(string&) { return false; }
+bool GdbStub::SendPacket(string const&) { return false; }
+bool GdbStub::SendOutput(string const&) { return false; }
+string GdbStub::Resume(bool) { return StopReply(); }
+
+#endif
+
+// Function to describe why the machine is stopped
+string GdbStub::StopReply() const
+{
+	if (interrupted) {
+		return "S02";
+	}
+
+	// stack faults are reported as a segmentation fault
+	if (chip8.GetFault() != FAULT_NONE) {
+		return "S0b";
+	}
+
+	if (debugger.LastStop() == DEBUG_WATCHPOINT) {
+		char const* kind = debugger.WatchKind() == WATCH_WRITE ? "watch" : debugger.WatchKind() == WATCH_READ ? "rwatch" : "awatch";
+		string reply = string("T05") + kind + ":";
+		char address[8];
+		snprintf(address, sizeof(address), "%x", debugger.WatchAddress());
+		return reply + address + ";";
+	}
+
+	return "S05";
+}
+
+// Function to answer the q packets a client needs to attach
+string GdbStub::Query(string const& packet)
+{
+	if (packet.compare(0, 10, "qSupported") == 0) {
+		return "PacketSize=4000;qXfer:features:read+";
+	}
+
+	if (packet.compare(0, 31, "qXfer:features:read:target.xml:") == 0) {
+		size_t comma = packet.find(',', 31);
+		uint32_t offset, length;
+		if (comma == string::npos || !ParseHex(packet, 31, comma, offset) || !ParseHex(packet, comma + 1, packet.size(), length)) {
+			return "E01";
+		}
+		size_t size = sizeof(GDB_TARGET_XML) - 1;
+
+		if (offset >= size) {
+			return "l";
+		}
+		string reply(1, length >= size - offset ? 'l' : 'm');
+		reply.append(GDB_TARGET_XML + offset, std::min<size_t>(length, size - offset));
+		return reply;
+	}
+
+	if (packet == "qAttached") {
+		return "1";
+	}
+	if (packet == "qC") {
+		return "QC1";
+	}
+	if (packet == "qfThreadInfo") {
+		return "m1";
+	}
+	if (packet == "qsThreadInfo") {
+		return "l";
+	}
+
+	// monitor commands arrive hex encoded
+	if (packet.compare(0, 6, "qRcmd,") == 0) {
+		string command;
+		for (size_t i = 6; i < packet.size(); i += 2) {
+			uint32_t c;
+			if (!ParseHex(packet, i, i + 2, c)) {
+				return "E01";
+			}
+			command += static_cast<char>(c);
+		}
+
+		if (command == "stack") {
+			Debugger::Registers registers = Debugger::ReadRegisters(chip8);
+			string text;
+			for (unsigned int level = 0; level < registers.sp && level < STACK_LEVELS; ++level) {
+				char line[32];
+				snprintf(line, sizeof(line), "#%u  0x%03x\n", level, Debugger::StackEntry(chip8, level));
+				text += line;
+			}
+			SendOutput(text.empty() ? "stack is empty\n" : text);
+			return "OK";
+		}
+
+		SendOutput("monitor commands: stack\n");
+		return "OK";
+	}
+
+	return "";
+}
+
+// Function to handle one packet from the client
+bool GdbStub::Handle(string const& packet)
+{
+	if (packet.empty()) {
+		return SendPacket("");
+	}
+
+	Debugger::Registers registers = Debugger::ReadRegisters(chip8);
+	string reply;
+
+	switch (packet[0]) {
+	case '?':
+		reply = StopReply();
+		break;
+
+	case 'g':
+		for (unsigned int number = 0; number < GDB_REGISTER_COUNT; ++number) {
+			unsigned int bytes;
+			uint32_t value = RegisterValue(registers, number, bytes);
+			PutHex(reply, value, bytes);
+		}
+		break;
+
+	case 'G': {
+		size_t pos = 1;
+		bool valid = true;
+		for (unsigned int number = 0; number < GDB_REGISTER_COUNT && pos < packet.size() && valid; ++number) {
+			unsigned int bytes;
+			uint32_t value;
+			RegisterValue(registers, number, bytes);
+			valid = GetHex(packet, pos, bytes, value);
+			SetRegister(registers, number, value);
+			pos += 2 * bytes;
+		}
+		if (!valid) {
+			reply = "E01";
+			break;
+		}
+		Debugger::WriteRegisters(chip8, registers);
+		reply = "OK";
+		break;
+	}
+
+	case 'p': {
+		uint32_t number;
+		if (!ParseHex(packet, 1, packet.size(), number) || number >= GDB_REGISTER_COUNT) {
+			reply = "E01";
+			break;
+		}
+		unsigned int bytes;
+		uint32_t value = RegisterValue(registers, number, bytes);
+		PutHex(reply, value, bytes);
+		break;
+	}
+
+	case 'P': {
+		size_t equals = packet.find('=');
+		uint32_t number, value;
+		unsigned int bytes;
+		if (equals == string::npos || !ParseHex(packet, 1, equals, number) || number >= GDB_REGISTER_COUNT) {
+			reply = "E01";
+			break;
+		}
+		RegisterValue(registers, number, bytes);
+		if (!GetHex(packet, equals + 1, bytes, value)) {
+			reply = "E01";
+			break;
+		}
+		SetRegister(registers, number, value);
+		Debugger::WriteRegisters(chip8, registers);
+		reply = "OK";
+		break;
+	}
+
+	case 'm': {
+		size_t comma = packet.find(',');
+		uint32_t address, length;
+		if (comma == string::npos || !ParseHex(packet, 1, comma, address) || !ParseHex(packet, comma + 1, packet.size(), length) ||
+			address >= MEMORY_SIZE) {
+			reply = "E01";
+			break;
+		}
+		for (uint32_t i = 0; i < length && address + i < MEMORY_SIZE; ++i) {
+			PutHex(reply, Debugger::ReadMemory(chip8, static_cast<uint16_t>(address + i)), 1);
+		}
+		break;
+	}
+
+	case 'M': {
+		size_t comma = packet.find(',');
+		size_t colon = packet.find(':');
+		uint32_t address, length;
+		if (comma == string::npos || colon == string::npos || colon < comma ||
+			!ParseHex(packet, 1, comma, address) || !ParseHex(packet, comma + 1, colon, length) ||
+			address > MEMORY_SIZE || length > MEMORY_SIZE - address || packet.size() - colon - 1 != 2 * length) {
+			reply = "E01";
+			break;
+		}
+
+		// checked whole before any of it is written
+		vector<uint8_t> bytes(length);
+		bool valid = true;
+		for (uint32_t i = 0; i < length && valid; ++i) {
+			uint32_t value;
+			valid = GetHex(packet, colon + 1 + 2 * i, 1, value);
+			bytes[i] = static_cast<uint8_t>(value);
+		}
+		if (!valid) {
+			reply = "E01";
+			break;
+		}
+		for (uint32_t i = 0; i < length; ++i) {
+			Debugger::WriteMemory(chip8, static_cast<uint16_t>(address + i), bytes[i]);
+		}
+		reply = "OK";
+		break;
+	}
+
+	case 'c':
+	case 's':
+		// optional resume address
+		if (packet.size() > 1) {
+			uint32_t address;
+			if (!ParseHex(packet, 1, packet.size(), address)) {
+				reply = "E01";
+				break;
+			}
+			registers.pc = static_cast<uint16_t>(address);
+			Debugger::WriteRegisters(chip8, registers);
+		}
+		reply = Resume(packet[0] == 's');
+		break;
+
+	case 'Z':
+	case 'z': {
+		// Z<type>,<address>,<length>: 0/1 breakpoint, 2 write, 3 read, 4 access watchpoint
+		bool insert = packet[0] == 'Z';
+		char type = packet.size() > 1 ? packet[1] : ' ';
+		size_t first = packet.find(',');
+		size_t second = packet.find(',', first + 1);
+		uint32_t address, length;
+		if (first == string::npos || second == string::npos ||
+			!ParseHex(packet, first + 1, second, address) || !ParseHex(packet, second + 1, packet.size(), length) ||
+			address >= MEMORY_SIZE || length > MEMORY_SIZE) {
+			reply = "E01";
+			break;
+		}
+
+		if (type == '0' || type == '1') {
+			debugger.SetBreakpoint(static_cast<uint16_t>(address), insert);
+		}
+		else if (type >= '2' && type <= '4') {
+			uint8_t kind = type == '2' ? WATCH_WRITE : type == '3' ? WATCH_READ : WATCH_ACCESS;
+			if (insert) {
+				debugger.AddWatchpoint(static_cast<uint16_t>(address), static_cast<uint16_t>(length), kind);
+			}
+			else {
+				debugger.RemoveWatchpoint(static_cast<uint16_t>(address), static_cast<uint16_t>(length), kind);
+			}
+		}
+		else {
+			break;
+		}
+		reply = "OK";
+		break;
+	}
+
+	case 'H':
+		reply = "OK";
+		break;
+
+	case 'q':
+		reply = Query(packet);
+		break;
+
+	case 'D':
+		SendPacket("OK");
+		return false;
+
+	case 'k':
+		return false;
+	}
+
+	return SendPacket(reply);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "debugger.h"
+#include <string>
+
+// GDB remote serial protocol server for one machine, so gdb (target remote :port) or any other
+// RSP client can attach. Registers are described to the client through target.xml:
+// v0-vf (8 bits), i (16), pc (16), sp (8), dt (8), st (8). "monitor stack" lists the call stack.
+// Linux only, elsewhere Serve fails.
+class GdbStub
+{
+	public:
+		GdbStub(Chip8& machine);
+
+		// waits for a client on 127.0.0.1:port and serves it until it detaches or kills the session
+		bool Serve(uint16_t port);
+
+	private:
+		bool ReadPacket(std::string& packet);
+		bool SendPacket(std::string const& payload);
+		bool SendOutput(std::string const& text);
+
+		// handles one packet, returns false when the session is over
+		bool Handle(std::string const& packet);
+		std::string Resume(bool step);
+		std::string StopReply() const;
+		std::string Query(std::string const& packet);
+
+		Chip8& chip8;
+		Debugger debugger;
+		int client{ -1 };
+		bool interrupted{};
+};
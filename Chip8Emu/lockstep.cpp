@@ -0,0 +1,157 @@
+// *********************************************************
+//
+//		  LOCKSTEP CHECK AGAINST THE REFERENCE INTERPRETER
+//
+// *********************************************************
+
+// header inclusion
+#include "lockstep.h"
+#include "debugger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+// most differing memory bytes and display rows listed in a report
+const unsigned int LOCKSTEP_REPORT_LINES = 16;
+
+// Checker constructor declaration
+LockstepChecker::LockstepChecker(Chip8& engine, unsigned int interval)
+	: engine(engine), reference(std::make_unique<Chip8>(engine)), interval(std::max(1u, interval))
+{
+	// the reference runs bare: no fusion, nothing attached and no early stops on drawing,
+	// so RunCycles on it is a plain loop over Step
+	reference->SetFusion(false);
+	reference->SetStopOnDisplay(false);
+	reference->AttachDebugger(nullptr);
+	reference->AttachTracer(nullptr);
+}
+
+// Function to run both machines, comparing them at every interval
+bool LockstepChecker::Run(unsigned int count)
+{
+	while (count > 0 && !diverged) {
+		unsigned int batch = std::min(count, interval - sinceCheck);
+
+		Chip8Run run = engine.RunCycles(batch);
+
+		// the reference runs exactly what the engine did, one instruction at a time
+		memcpy(reference->keys, engine.keys, sizeof(engine.keys));
+		unsigned int stepped = reference->RunCycles(run.executed).executed;
+
+		executed += run.executed;
+		sinceCheck += run.executed;
+		count -= std::min(count, run.executed);
+
+		if (stepped != run.executed || sinceCheck >= interval || run.stop == STOP_FAULT) {
+			if (!Check()) {
+				return false;
+			}
+		}
+
+		// a faulted engine won't run any further, and neither will a matching reference
+		if (run.stop == STOP_FAULT || (run.executed == 0 && run.stop != STOP_BUDGET)) {
+			break;
+		}
+	}
+
+	return !diverged;
+}
+
+// Function to compare the two machines by hash, describing them in full if they differ
+bool LockstepChecker::Check()
+{
+	if (diverged) {
+		return false;
+	}
+
+	++comparisons;
+	sinceCheck = 0;
+
+	if (engine.StateHash() == reference->StateHash()) {
+		lastGood = executed;
+		return true;
+	}
+
+	diverged = true;
+	Describe();
+	return false;
+}
+
+// Function to write out every architectural difference between the machines
+void LockstepChecker::Describe()
+{
+	char line[256];
+	report.clear();
+
+	snprintf(line, sizeof(line), "state differs after instruction %llu, last matched after %llu\n",
+		static_cast<unsigned long long>(executed), static_cast<unsigned long long>(lastGood));
+	report += line;
+	size_t header = report.size();
+
+	// Function to add a line for a scalar field that differs
+	auto field = [&](char const* name, unsigned int fast, unsigned int slow) {
+		if (fast != slow) {
+			snprintf(line, sizeof(line), "  %-6s engine %04X  reference %04X\n", name, fast, slow);
+			report += line;
+		}
+	};
+
+	Debugger::Registers fast = Debugger::ReadRegisters(engine);
+	Debugger::Registers slow = Debugger::ReadRegisters(*reference);
+
+	for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+		char name[4] = { 'V', "0123456789ABCDEF"[i], 0 };
+		field(name, fast.v[i], slow.v[i]);
+	}
+	field("I", fast.index, slow.index);
+	field("PC", fast.pc, slow.pc);
+	field("SP", fast.sp, slow.sp);
+	field("DT", fast.delay, slow.delay);
+	field("ST", fast.sound, slow.sound);
+	field("fault", engine.GetFault(), reference->GetFault());
+
+	for (unsigned int level = 0; level < std::min<unsigned int>(std::max(fast.sp, slow.sp), STACK_LEVELS); ++level) {
+		char name[16];
+		snprintf(name, sizeof(name), "stack%X", level);
+		field(name, Debugger::StackEntry(engine, level), Debugger::StackEntry(*reference, level));
+	}
+
+	unsigned int memoryDiffs = 0;
+	for (unsigned int address = 0; address < MEMORY_SIZE; ++address) {
+		uint8_t a = Debugger::ReadMemory(engine, static_cast<uint16_t>(address));
+		uint8_t b = Debugger::ReadMemory(*reference, static_cast<uint16_t>(address));
+		if (a != b && memoryDiffs++ < LOCKSTEP_REPORT_LINES) {
+			snprintf(line, sizeof(line), "  [%03X]  engine %02X  reference %02X\n", address, a, b);
+			report += line;
+		}
+	}
+	if (memoryDiffs > LOCKSTEP_REPORT_LINES) {
+		snprintf(line, sizeof(line), "  ... %u memory bytes differ in all\n", memoryDiffs);
+		report += line;
+	}
+
+	// rows that differ, engine above reference
+	unsigned int rowDiffs = 0;
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		uint64_t a = engine.display[row];
+		uint64_t b = reference->display[row];
+		if (a == b || rowDiffs++ >= LOCKSTEP_REPORT_LINES) {
+			continue;
+		}
+
+		string engineRow, referenceRow;
+		for (unsigned int col = 0; col < VIDEO_WIDTH; ++col) {
+			engineRow += ((a >> (VIDEO_WIDTH - 1 - col)) & 1u) ? '#' : '.';
+			referenceRow += ((b >> (VIDEO_WIDTH - 1 - col)) & 1u) ? '#' : '.';
+		}
+		snprintf(line, sizeof(line), "  row %2u engine    %s\n         reference %s\n", row, engineRow.c_str(), referenceRow.c_str());
+		report += line;
+	}
+
+	// everything visible matches, so the hashes can only differ on the random generator
+	if (report.size() == header) {
+		report += "  random generator state\n";
+	}
+}
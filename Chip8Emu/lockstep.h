@@ -0,0 +1,47 @@
+#pragma once
+#include "chip8.h"
+#include <memory>
+#include <string>
+
+// Runs a machine on its fast engine next to a copy of it stepped one instruction at a time by the
+// reference interpreter (the decoded handlers alone, no fusion or idle-loop skipping), and
+// compares the two by StateHash every interval instructions. On a mismatch it writes out a full
+// diff of the architectural state. A longer interval trades how precisely a divergence is placed
+// for less checking overhead; the reference run itself costs the same either way.
+class LockstepChecker
+{
+	public:
+		// copies engine as the reference, so load the ROM and seed the machine first
+		LockstepChecker(Chip8& engine, unsigned int interval);
+
+		// runs count instructions on both machines, the reference is handed engine's keys as they are.
+		// Returns false at the first comparison that fails, Report() then describes the difference
+		bool Run(unsigned int count);
+
+		// compares the machines now, whether or not an interval has passed
+		bool Check();
+
+		// the diff from the last failed comparison
+		std::string const& Report() const { return report; }
+
+		uint64_t Executed() const { return executed; }
+		uint64_t Comparisons() const { return comparisons; }
+
+		// the reference machine, in the state of the last comparison when one failed
+		Chip8 const& Reference() const { return *reference; }
+
+	private:
+		// writes out everything the two machines disagree on
+		void Describe();
+
+		Chip8& engine;
+		std::unique_ptr<Chip8> reference;
+		unsigned int interval;
+
+		uint64_t executed{};			// instructions run on both machines
+		uint64_t lastGood{};			// instruction count at the last comparison that passed
+		unsigned int sinceCheck{};		// instructions since the last comparison
+		uint64_t comparisons{};
+		bool diverged{};
+		std::string report;
+};
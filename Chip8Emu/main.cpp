@@ -6,18 +6,45 @@
 
 // Libraries
 #include "chip8.h"
+#include "capture.h"
+#include "netplay.h"
+#include "phasetrace.h"
 #include "platform.h"
+#include "trace.h"
+#ifndef _WIN32
+#include "sharedexport.h"
+#endif
+#include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <memory>
 #include <string>
 
 using namespace std;
 
+// instructions run per loop when fast-forwarding with no speed limit
+const unsigned int UNTHROTTLED_BATCH = 10000;
+
+// rate at which the display is sampled when recording
+const unsigned int CAPTURE_FPS = 60;
+
+// frames per second both sides of a netplay session run at
+const unsigned int NETPLAY_FPS = 60;
+
 int main(int argc, char* argv[])
 {
-	if (argc != 4)
+	if (argc < 4)
 	{
-		std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM>\n";
+		std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM> [--turbo] [--speed <N>] [--frameskip <N>] [--record <File>] [--trace <File>] [--platform <Name>] [--export <Name>] [--phases <File>] [--netplay <Port> <Host> <Remote port>]\n";
+		std::cerr << "  --turbo          start in fast-forward mode (Tab toggles it while running)\n";
+		std::cerr << "  --speed <N>      fast-forward runs N times normal speed, 0 for unthrottled (default 8)\n";
+		std::cerr << "  --frameskip <N>  fast-forward presents every Nth frame (default 8)\n";
+		std::cerr << "  --record <File>  capture the display at 60 frames per second (see Chip8Tools capconv)\n";
+		std::cerr << "  --trace <File>   record every executed instruction (see Chip8Tools trace diff)\n";
+		std::cerr << "  --platform <Name> sdl, terminal or null (default " << DefaultPlatform() << ")\n";
+		std::cerr << "  --export <Name>  publish the display and registers to POSIX shared memory /Name (see Chip8Tools shm)\n";
+		std::cerr << "  --phases <File>  time the host loop phases to a Chrome trace, written on exit and on SIGUSR1\n";
+		std::cerr << "  --netplay <Port> <Host> <Remote port>  two-player rollback netplay over UDP with the emulator at Host\n";
 		std::exit(EXIT_FAILURE);
 	}
 
@@ -25,32 +52,322 @@ int main(int argc, char* argv[])
 	int cycleDelay = std::stoi(argv[2]);
 	char const* romFilename = argv[3];
 
-	Platform platform("CHIP-8 Emulator", VIDEO_WIDTH * videoScale, VIDEO_HEIGHT * videoScale, VIDEO_WIDTH, VIDEO_HEIGHT);
+	bool turbo = false;
+	unsigned int turboSpeed = 8;
+	unsigned int frameSkip = 8;
+	char const* recordFilename = nullptr;
+	char const* traceFilename = nullptr;
+	string platformName = DefaultPlatform();
+	char const* exportName = nullptr;
+	char const* phasesFilename = nullptr;
+	char const* netplayHost = nullptr;
+	uint16_t netplayPort = 0;
+	uint16_t netplayRemotePort = 0;
+
+	for (int i = 4; i < argc; i++)
+	{
+		string option = argv[i];
+
+		if (option == "--turbo")
+		{
+			turbo = true;
+		}
+		else if (option == "--speed" && i + 1 < argc)
+		{
+			turboSpeed = std::stoul(argv[++i]);
+		}
+		else if (option == "--frameskip" && i + 1 < argc)
+		{
+			frameSkip = std::max(1ul, std::stoul(argv[++i]));
+		}
+		else if (option == "--record" && i + 1 < argc)
+		{
+			recordFilename = argv[++i];
+		}
+		else if (option == "--trace" && i + 1 < argc)
+		{
+			traceFilename = argv[++i];
+		}
+		else if (option == "--platform" && i + 1 < argc)
+		{
+			platformName = argv[++i];
+		}
+		else if (option == "--export" && i + 1 < argc)
+		{
+			exportName = argv[++i];
+		}
+		else if (option == "--phases" && i + 1 < argc)
+		{
+			phasesFilename = argv[++i];
+		}
+		else if (option == "--netplay" && i + 3 < argc)
+		{
+			netplayPort = static_cast<uint16_t>(std::stoul(argv[++i]));
+			netplayHost = argv[++i];
+			netplayRemotePort = static_cast<uint16_t>(std::stoul(argv[++i]));
+		}
+		else
+		{
+			std::cerr << "Unknown option: " << option << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	std::unique_ptr<Platform> platform = CreatePlatform(platformName, "CHIP-8 Emulator",
+		VIDEO_WIDTH * videoScale, VIDEO_HEIGHT * videoScale, VIDEO_WIDTH, VIDEO_HEIGHT);
+	if (!platform)
+	{
+		std::cerr << "Platform " << platformName << " isn't available in this build\n";
+		std::exit(EXIT_FAILURE);
+	}
+	platform->SetFastForward(turbo);
 
 	Chip8 chip8;
 	chip8.LoadROM(romFilename);
 
-	int videoPitch = sizeof(chip8.display[0]) * VIDEO_WIDTH;
+	// the machine keeps its display a bit per pixel, the platforms draw 32-bit pixels
+	uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT]{};
+	int videoPitch = sizeof(pixels[0]) * VIDEO_WIDTH;
+
+	// both sides start from the same seed and frame length, the session runs its own copy of the machine
+	std::unique_ptr<NetplaySession> netplay;
+	if (netplayHost)
+	{
+		if (traceFilename)
+		{
+			std::cerr << "--trace can't follow a netplay session, which runs frames again when it rolls back\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		chip8.SeedRandom(0);
+		chip8.SetCyclesPerFrame(std::max(1, 1000 / (static_cast<int>(NETPLAY_FPS) * std::max(cycleDelay, 1))));
+		netplay = std::make_unique<NetplaySession>(chip8);
+		if (!netplay->Open(netplayPort) || !netplay->Connect(netplayHost, netplayRemotePort))
+		{
+			std::cerr << "Can't open UDP port " << netplayPort << " to " << netplayHost << ":" << netplayRemotePort << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	// what is shown, exported and recorded: the machine the loop runs, or the netplay session's
+	Chip8 const& shown = netplay ? netplay->Machine() : chip8;
+
+	// the recorder encodes and writes on its own thread, the loop only hands it frames
+	std::unique_ptr<FrameRecorder> recorder;
+	if (recordFilename)
+	{
+		recorder = std::make_unique<FrameRecorder>(recordFilename, CAPTURE_FPS);
+		if (!recorder->IsOpen())
+		{
+			std::cerr << "Can't open " << recordFilename << " for recording\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	// the tracer is attached for the whole run and flushed on exit
+	std::unique_ptr<TraceRecorder> tracer;
+	if (traceFilename)
+	{
+		tracer = std::make_unique<TraceRecorder>(traceFilename);
+		if (!tracer->IsOpen())
+		{
+			std::cerr << "Can't open " << traceFilename << " for tracing\n";
+			std::exit(EXIT_FAILURE);
+		}
+		chip8.AttachTracer(tracer.get());
+	}
+
+#ifndef _WIN32
+	// other processes read the machine from shared memory, it's published once per presented frame
+	std::unique_ptr<SharedStateExporter> exporter;
+	if (exportName)
+	{
+		exporter = std::make_unique<SharedStateExporter>(exportName, 1);
+		if (!exporter->IsOpen())
+		{
+			std::cerr << "Can't create shared memory " << exportName << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+#else
+	if (exportName)
+	{
+		std::cerr << "--export needs POSIX shared memory\n";
+		std::exit(EXIT_FAILURE);
+	}
+#endif
+
+#ifdef CHIP8_PHASE_TRACING
+	if (phasesFilename)
+	{
+		PhaseTracer::Start();
+	}
+#else
+	if (phasesFilename)
+	{
+		std::cerr << "--phases needs a build with CHIP8_PHASE_TRACING\n";
+		std::exit(EXIT_FAILURE);
+	}
+#endif
 
-	auto lastCycleTime = std::chrono::high_resolution_clock::now();
+	auto startTime = std::chrono::high_resolution_clock::now();
+	auto lastCycleTime = startTime;
+	uint32_t nextCaptureFrame = 0;
 	bool quit = false;
+	unsigned int skippedFrames = 0;
 
 	while (!quit)
 	{
-		quit = platform.ProcessInput(chip8.keys);
+		// most passes find nothing due, only the ones that run or capture a frame are kept in the trace
+		PhaseFrame frame("frame");
+
+		{
+			PhaseSpan span("ProcessInput");
+			quit = platform->ProcessInput(chip8.keys);
+			// the beeper is muted while fast-forwarding, it would buzz at whatever rate frames are skipped
+			platform->SetSound(shown.SoundActive() && !platform->FastForward());
+		}
 
 		auto currentTime = std::chrono::high_resolution_clock::now();
 		float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
+		bool ran = false;
+		bool captured = false;
+
+		if (netplay)
+		{
+			// frames keep to the same rate on both sides, one the remote side holds back is tried again next pass
+			if (dt >= 1000.0f / NETPLAY_FPS)
+			{
+				uint16_t localKeys = 0;
+				for (unsigned int key = 0; key < KEY_COUNT; key++)
+				{
+					localKeys |= chip8.keys[key] ? (1u << key) : 0u;
+				}
 
-		if (dt > cycleDelay)
+				bool advanced;
+				{
+					PhaseSpan span("Netplay");
+					advanced = netplay->Advance(localKeys);
+				}
+
+				if (advanced)
+				{
+					lastCycleTime = currentTime;
+					ran = true;
+
+					PhaseSpan span("Update");
+					shown.RenderPixels(pixels);
+					platform->Update(pixels, videoPitch);
+				}
+			}
+		}
+		else if (platform->FastForward())
+		{
+			// a frame runs turboSpeed instructions per delay, or a large batch as often as possible
+			if (turboSpeed == 0 || dt > cycleDelay)
+			{
+				lastCycleTime = currentTime;
+
+				{
+					PhaseSpan span("RunCycles");
+					chip8.RunCycles(turboSpeed == 0 ? UNTHROTTLED_BATCH : turboSpeed);
+				}
+				ran = true;
+
+				// rendering is the expensive part, so only every Nth frame is presented
+				if (++skippedFrames >= frameSkip)
+				{
+					skippedFrames = 0;
+					PhaseSpan span("Update");
+					chip8.RenderPixels(pixels);
+					platform->Update(pixels, videoPitch);
+				}
+			}
+		}
+		else if (dt > cycleDelay)
 		{
 			lastCycleTime = currentTime;
 
-			chip8.Cycle();
+			{
+				PhaseSpan span("Cycle");
+				chip8.Cycle();
+			}
+			ran = true;
+
+			PhaseSpan span("Update");
+			chip8.RenderPixels(pixels);
+			platform->Update(pixels, videoPitch);
+		}
+
+#ifndef _WIN32
+		// readers see every batch, including the ones fast-forward doesn't present
+		if (exporter && ran)
+		{
+			PhaseSpan span("Publish");
+			exporter->Publish(0, shown);
+		}
+#endif
+
+		// sample the display once per capture frame of wall-clock time
+		if (recorder)
+		{
+			uint32_t captureFrame = static_cast<uint32_t>(std::chrono::duration<double>(currentTime - startTime).count() * CAPTURE_FPS);
+			if (captureFrame >= nextCaptureFrame)
+			{
+				PhaseSpan span("Submit");
+				recorder->Submit(shown.display, captureFrame);
+				nextCaptureFrame = captureFrame + 1;
+				captured = true;
+			}
+		}
+
+		if (!ran && !captured)
+		{
+			frame.Discard();
+		}
+
+#ifdef CHIP8_PHASE_TRACING
+		// a snapshot of the trace so far, the run goes on
+		if (phasesFilename && PhaseTracer::TakeDumpRequest())
+		{
+			PhaseTracer::Dump(phasesFilename);
+		}
+#endif
+	}
+
+	if (recorder)
+	{
+		recorder->Close();
+		std::cout << "Recorded " << recorder->Written() << " frames, dropped " << recorder->Dropped() << "\n";
+	}
 
-			platform.Update(chip8.display, videoPitch);
+	if (netplay)
+	{
+		NetplayStats const& stats = netplay->Stats();
+		std::cout << "Netplay ran " << stats.frames << " frames with " << stats.rollbacks << " rollbacks and "
+			<< stats.stalls << " stalls, " << stats.desyncs << " desyncs in " << stats.hashesChecked << " checks\n";
+	}
+
+	if (tracer)
+	{
+		chip8.AttachTracer(nullptr);
+		tracer->Close();
+		std::cout << "Traced " << tracer->Recorded() << " instructions in " << tracer->Bytes() << " bytes\n";
+	}
+
+#ifdef CHIP8_PHASE_TRACING
+	if (phasesFilename)
+	{
+		if (PhaseTracer::Dump(phasesFilename))
+		{
+			std::cout << "Wrote host phase trace to " << phasesFilename << "\n";
+		}
+		else
+		{
+			std::cerr << "Can't write " << phasesFilename << "\n";
 		}
 	}
+#endif
 
 	return 0;
-}
\ No newline at end of file
+}
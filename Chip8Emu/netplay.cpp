@@ -0,0 +1,370 @@
+// *********************************************************
+//
+//			     ROLLBACK NETPLAY OVER UDP
+//
+// *********************************************************
+
+// header inclusion
+#include "netplay.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// snapshots kept, enough to go back the furthest a frame can run ahead of the remote keys
+const uint32_t NETPLAY_SNAPSHOTS = NETPLAY_MAX_ROLLBACK + 1;
+
+const uint32_t NO_ROLLBACK = 0xFFFFFFFFu;
+
+// header bytes before the keys, and the check after them
+const size_t NETPLAY_HEADER_SIZE = 13;
+const size_t NETPLAY_CHECK_SIZE = 12;
+
+// Function to read the steady clock in nanoseconds
+static uint64_t NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Function to append a little-endian value of size bytes
+static void PutLE(vector<uint8_t>& out, uint64_t value, unsigned int size)
+{
+	for (unsigned int i = 0; i < size; ++i) {
+		out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+	}
+}
+
+// Function to read a little-endian value of size bytes
+static uint64_t GetLE(uint8_t const* bytes, unsigned int size)
+{
+	uint64_t value = 0;
+	for (unsigned int i = 0; i < size; ++i) {
+		value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+	}
+	return value;
+}
+
+// Session constructor declaration
+NetplaySession::NetplaySession(Chip8 const& start)
+	: machine(std::make_unique<Chip8>(start)), snapshots(std::make_unique<Chip8[]>(NETPLAY_SNAPSHOTS)), rollbackFrom(NO_ROLLBACK)
+{
+	// the state a frame later depends on the ROM, the seed and the cycles per frame alike
+	Chip8 probe = start;
+	memset(probe.keys, 0, KEY_COUNT);
+	probe.RunUntilFrame();
+	uint64_t hash = probe.StateHash();
+	session = static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+// Function to run one frame with the local keys and the remote ones, known or predicted
+void NetplaySession::RunFrame(uint32_t number)
+{
+	uint16_t remote = 0;
+	if (number < remoteFrames) {
+		remote = remoteKeys[number % NETPLAY_HISTORY];
+	}
+	else if (remoteFrames > 0) {
+		// predict the remote player still holds what they held last
+		remote = remoteKeys[(remoteFrames - 1) % NETPLAY_HISTORY];
+	}
+	usedKeys[number % NETPLAY_HISTORY] = remote;
+
+	uint16_t held = localKeys[number % NETPLAY_HISTORY] | remote;
+	for (unsigned int key = 0; key < KEY_COUNT; ++key) {
+		machine->keys[key] = (held >> key) & 1u;
+	}
+
+	machine->RunUntilFrame();
+}
+
+// Function to go back to the start of a mispredicted frame and run up to the current one again
+void NetplaySession::Rollback(uint32_t from)
+{
+	uint64_t start = NowNs();
+
+	*machine = snapshots[from % NETPLAY_SNAPSHOTS];
+	for (uint32_t number = from; number < frame; ++number) {
+		if (number != from) {
+			snapshots[number % NETPLAY_SNAPSHOTS] = *machine;
+		}
+		RunFrame(number);
+	}
+
+	uint64_t elapsed = NowNs() - start;
+	++stats.rollbacks;
+	stats.resimulated += frame - from;
+	stats.longestRollback = std::max(stats.longestRollback, frame - from);
+	stats.rollbackNs += elapsed;
+	stats.maxRollbackNs = std::max(stats.maxRollbackNs, elapsed);
+	rollbackFrom = NO_ROLLBACK;
+}
+
+// Function to hash the start of every frame newly run with only confirmed keys before it
+void NetplaySession::UpdateConfirmedHash()
+{
+	uint32_t confirmed = ConfirmedFrames();
+
+	for (uint32_t number = hashedFrame + 1; number <= confirmed; ++number) {
+		Chip8 const& state = number == frame ? *machine : snapshots[number % NETPLAY_SNAPSHOTS];
+		hashes[number % NETPLAY_HISTORY] = state.StateHash();
+		hashedFrame = number;
+	}
+
+	CompareHashes();
+}
+
+// Function to check the remote side's newest hash once this side has hashed the same frame
+void NetplaySession::CompareHashes()
+{
+	if (remoteCheck <= checkedFrame || remoteCheck > hashedFrame || hashedFrame - remoteCheck >= NETPLAY_HISTORY) {
+		return;
+	}
+
+	++stats.hashesChecked;
+	if (remoteCheckHash != hashes[remoteCheck % NETPLAY_HISTORY]) {
+		++stats.desyncs;
+	}
+	checkedFrame = remoteCheck;
+}
+
+// Function to take in one packet from the remote side
+void NetplaySession::Accept(uint8_t const* packet, size_t size)
+{
+	if (size < NETPLAY_HEADER_SIZE || GetLE(packet, 4) != session) {
+		++stats.packetsIgnored;
+		return;
+	}
+
+	uint32_t ack = static_cast<uint32_t>(GetLE(packet + 4, 4));
+	uint32_t first = static_cast<uint32_t>(GetLE(packet + 8, 4));
+	unsigned int count = packet[12];
+	if (count > NETPLAY_MAX_INPUTS || size != NETPLAY_HEADER_SIZE + 2 * count + NETPLAY_CHECK_SIZE || ack > frame) {
+		++stats.packetsIgnored;
+		return;
+	}
+	++stats.packetsReceived;
+
+	remoteAck = std::max(remoteAck, ack);
+
+	// only the next frame in order is taken, a gap is filled by a later packet repeating it
+	for (unsigned int i = 0; i < count; ++i) {
+		uint32_t number = first + i;
+		if (number != remoteFrames || number >= frame + NETPLAY_HISTORY - NETPLAY_SNAPSHOTS) {
+			continue;
+		}
+
+		uint16_t keys = static_cast<uint16_t>(GetLE(packet + NETPLAY_HEADER_SIZE + 2 * i, 2));
+		remoteKeys[number % NETPLAY_HISTORY] = keys;
+		if (number < frame && keys != usedKeys[number % NETPLAY_HISTORY]) {
+			rollbackFrom = std::min(rollbackFrom, number);
+		}
+		++remoteFrames;
+	}
+
+	// both sides must have hashed the same state for a frame both ran with confirmed keys
+	uint8_t const* check = packet + NETPLAY_HEADER_SIZE + 2 * count;
+	uint32_t checkFrame = static_cast<uint32_t>(GetLE(check, 4));
+	if (checkFrame > remoteCheck) {
+		remoteCheck = checkFrame;
+		remoteCheckHash = GetLE(check + 4, 8);
+	}
+}
+
+// Function to build the packet for the current state and send it, at most every NETPLAY_RESEND_MS unless always
+void NetplaySession::Send(bool always)
+{
+	FlushDelayed();
+
+	uint64_t now = NowNs();
+	if (!always && now - lastSent < NETPLAY_RESEND_MS * 1000000ull) {
+		return;
+	}
+	lastSent = now;
+
+	uint32_t first = remoteAck;
+	uint32_t count = std::min(frame - first, NETPLAY_MAX_INPUTS);
+
+	vector<uint8_t> packet;
+	packet.reserve(NETPLAY_HEADER_SIZE + 2 * NETPLAY_MAX_INPUTS + NETPLAY_CHECK_SIZE);
+	PutLE(packet, session, 4);
+	PutLE(packet, remoteFrames, 4);
+	PutLE(packet, first, 4);
+	PutLE(packet, count, 1);
+	for (uint32_t i = 0; i < count; ++i) {
+		PutLE(packet, localKeys[(first + i) % NETPLAY_HISTORY], 2);
+	}
+	PutLE(packet, hashedFrame, 4);
+	PutLE(packet, hashes[hashedFrame % NETPLAY_HISTORY], 8);
+
+	Transmit(packet);
+}
+
+// Function to send a packet through the simulated link
+void NetplaySession::Transmit(vector<uint8_t> const& bytes)
+{
+	if (lossPercent > 0 && linkRandom() % 100 < lossPercent) {
+		++stats.packetsLost;
+		return;
+	}
+
+	if (latencyMs > 0) {
+		delayed.push_back({ NowNs() + latencyMs * 1000000ull, bytes });
+		return;
+	}
+
+	SendNow(bytes);
+}
+
+// Function to send the held back packets that are due
+void NetplaySession::FlushDelayed()
+{
+	uint64_t now = NowNs();
+
+	while (!delayed.empty() && delayed.front().due <= now) {
+		SendNow(delayed.front().bytes);
+		delayed.pop_front();
+	}
+}
+
+// Function to set up the simulated link
+void NetplaySession::SetLink(unsigned int latency, unsigned int loss, uint32_t seed)
+{
+	latencyMs = latency;
+	lossPercent = std::min(loss, 100u);
+	linkRandom.seed(seed);
+}
+
+// Function to run the next frame unless the remote side is too far behind
+bool NetplaySession::Advance(uint16_t keys)
+{
+	Receive();
+	if (rollbackFrom != NO_ROLLBACK) {
+		Rollback(rollbackFrom);
+	}
+	UpdateConfirmedHash();
+
+	// a frame further ahead couldn't be rolled back to if its prediction turned out wrong
+	if (frame >= remoteFrames + NETPLAY_MAX_ROLLBACK) {
+		++stats.stalls;
+		Send(false);
+		return false;
+	}
+
+	localKeys[frame % NETPLAY_HISTORY] = keys;
+	snapshots[frame % NETPLAY_SNAPSHOTS] = *machine;
+	RunFrame(frame);
+	++frame;
+	++stats.frames;
+	UpdateConfirmedHash();
+
+	Send(true);
+	return true;
+}
+
+// Function to keep the session going without running a frame
+void NetplaySession::Idle()
+{
+	Receive();
+	if (rollbackFrom != NO_ROLLBACK) {
+		Rollback(rollbackFrom);
+	}
+	UpdateConfirmedHash();
+
+	Send(false);
+}
+
+#ifdef __linux__
+
+NetplaySession::~NetplaySession()
+{
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+// Function to bind the session's UDP socket
+bool NetplaySession::Open(uint16_t requestedPort)
+{
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return false;
+	}
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(requestedPort);
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	socklen_t length = sizeof(address);
+	if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+		getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+		close(fd);
+		fd = -1;
+		return false;
+	}
+
+	port = ntohs(address.sin_port);
+	return true;
+}
+
+// Function to set where packets go
+bool NetplaySession::Connect(char const* host, uint16_t peerPort)
+{
+	in_addr address{};
+	if (inet_pton(AF_INET, host, &address) != 1) {
+		return false;
+	}
+
+	remoteHost = address.s_addr;
+	remotePort = htons(peerPort);
+	return true;
+}
+
+// Function to send a packet to the remote side
+void NetplaySession::SendNow(vector<uint8_t> const& bytes)
+{
+	if (fd < 0 || remoteHost == 0) {
+		return;
+	}
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = remotePort;
+	address.sin_addr.s_addr = remoteHost;
+
+	// a full socket buffer loses the packet like the network would, the next one repeats it
+	if (sendto(fd, bytes.data(), bytes.size(), 0, reinterpret_cast<sockaddr*>(&address), sizeof(address)) >= 0) {
+		++stats.packetsSent;
+	}
+}
+
+// Function to take in every packet waiting on the socket
+void NetplaySession::Receive()
+{
+	FlushDelayed();
+
+	uint8_t packet[512];
+	for (;;) {
+		ssize_t size = recv(fd, packet, sizeof(packet), 0);
+		if (size < 0) {
+			break;
+		}
+		Accept(packet, static_cast<size_t>(size));
+	}
+}
+
+#else
+
+NetplaySession::~NetplaySession() {}
+bool NetplaySession::Open(uint16_t) { return false; }
+bool NetplaySession::Connect(char const*, uint16_t) { return false; }
+void NetplaySession::SendNow(vector<uint8_t> const&) {}
+void NetplaySession::Receive() {}
+
+#endif
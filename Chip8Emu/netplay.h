@@ -0,0 +1,140 @@
+#pragma once
+#include "chip8.h"
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// NETPLAY PROTOCOL
+// One UDP datagram per frame each way, integers little endian:
+//   session (u32)      the ROM and settings both sides start from, other sessions' packets are ignored
+//   ack (u32)          how many of the receiver's inputs the sender has, frames 0 to ack - 1
+//   first (u32)        frame of the first input carried
+//   count (u8)         inputs carried, up to NETPLAY_MAX_INPUTS
+//   keys (u16)[count]  the sender's keys for frames first to first + count - 1, bit n is key n
+//   check (u32)        a frame the sender ran with every input confirmed, 0 when there is none yet
+//   hash (u64)         the sender's StateHash at the start of that frame
+// Every packet repeats all the inputs the other side hasn't acknowledged, so a lost packet costs
+// nothing once a later one arrives.
+
+const uint32_t NETPLAY_MAX_ROLLBACK = 12;	// frames run ahead of the remote inputs before stalling
+const uint32_t NETPLAY_MAX_INPUTS = 32;
+const uint32_t NETPLAY_HISTORY = 64;		// frames of inputs and hashes kept, a power of two
+const unsigned int NETPLAY_RESEND_MS = 5;	// how often a stalled or idle side repeats its last packet
+
+// What a session did so far
+struct NetplayStats {
+	uint64_t frames{};
+	uint64_t stalls{};				// Advance calls that waited for the remote side
+	uint64_t rollbacks{};
+	uint64_t resimulated{};			// frames run again after a misprediction
+	uint32_t longestRollback{};		// most frames one rollback ran again
+	uint64_t rollbackNs{};			// restoring and running again, in total
+	uint64_t maxRollbackNs{};
+	uint64_t packetsSent{};
+	uint64_t packetsLost{};			// dropped on purpose by SetLink
+	uint64_t packetsReceived{};
+	uint64_t packetsIgnored{};		// malformed or from another session
+	uint64_t hashesChecked{};
+	uint64_t desyncs{};				// confirmed frames whose hash differed from the remote's
+};
+
+// Two-player rollback netplay. Each side runs its own machine and the sides exchange only their
+// keys. A frame runs as soon as the local keys are known, with the remote keys predicted to be the
+// last ones received. When the real remote keys for a frame arrive and differ from the prediction,
+// the machine is restored to the snapshot taken before that frame and the frames since are run
+// again. A snapshot is a copy of the machine, which is trivially copyable, so rolling back the
+// full NETPLAY_MAX_ROLLBACK frames takes microseconds.
+// The keys of both players are ORed together, so each player holds their own keys of the same
+// keypad, as two-player CHIP-8 games expect. Both sides must start from the same machine, seeded
+// the same with SeedRandom, with the same cycles per frame, which makes Cxkk agree.
+// UDP on Linux only, elsewhere Open fails.
+class NetplaySession
+{
+	public:
+		// starts from a copy of start, frame 0
+		explicit NetplaySession(Chip8 const& start);
+		~NetplaySession();
+
+		NetplaySession(NetplaySession const&) = delete;
+		NetplaySession& operator=(NetplaySession const&) = delete;
+
+		// binds a UDP socket to port on all interfaces (0 picks a free port, see Port)
+		bool Open(uint16_t port);
+		uint16_t Port() const { return port; }
+
+		// sends to the other side at host:peerPort, host being an IPv4 address
+		bool Connect(char const* host, uint16_t peerPort);
+
+		// simulates a bad link on outgoing packets: held back latencyMs, then lost lossPercent of the time
+		void SetLink(unsigned int latencyMs, unsigned int lossPercent, uint32_t seed);
+
+		// runs the next frame with the local keys (bit n is key n), after any rollback the packets
+		// received since call for. Returns false without running it when too far ahead of the remote side
+		bool Advance(uint16_t localKeys);
+
+		// receives, rolls back and sends without running a frame, for waiting on the remote side
+		void Idle();
+
+		// the machine at the start of Frame, displaying the last frame run
+		Chip8 const& Machine() const { return *machine; }
+
+		// frames run so far, and how many of them ran with confirmed remote keys
+		uint32_t Frame() const { return frame; }
+		uint32_t ConfirmedFrames() const { return std::min(frame, remoteFrames); }
+
+		// frames of local keys the remote side has acknowledged
+		uint32_t Acknowledged() const { return remoteAck; }
+
+		NetplayStats const& Stats() const { return stats; }
+
+	private:
+		// an outgoing packet held back by SetLink
+		struct Delayed {
+			uint64_t due;
+			std::vector<uint8_t> bytes;
+		};
+
+		void Receive();
+		void Accept(uint8_t const* packet, size_t size);
+		void Rollback(uint32_t from);
+		void RunFrame(uint32_t number);
+		void UpdateConfirmedHash();
+		void CompareHashes();
+		void Send(bool always);
+		void Transmit(std::vector<uint8_t> const& bytes);
+		void SendNow(std::vector<uint8_t> const& bytes);
+		void FlushDelayed();
+
+		std::unique_ptr<Chip8> machine;
+		std::unique_ptr<Chip8[]> snapshots;		// the machine at the start of frame n, at n % (NETPLAY_MAX_ROLLBACK + 1)
+		uint32_t session{};
+
+		uint32_t frame{};				// next frame to run
+		uint32_t remoteFrames{};		// remote keys received for frames 0 to remoteFrames - 1
+		uint32_t remoteAck{};			// local keys the remote side has
+		uint32_t rollbackFrom;			// earliest mispredicted frame, NO_ROLLBACK when there is none
+
+		uint16_t localKeys[NETPLAY_HISTORY]{};
+		uint16_t remoteKeys[NETPLAY_HISTORY]{};
+		uint16_t usedKeys[NETPLAY_HISTORY]{};		// remote keys each frame last ran with
+
+		uint32_t hashedFrame{};			// newest confirmed frame start hashed, 0 for none
+		uint64_t hashes[NETPLAY_HISTORY]{};
+		uint32_t checkedFrame{};		// newest remote hash compared
+		uint32_t remoteCheck{};			// newest remote hash received, compared once this side hashed its frame
+		uint64_t remoteCheckHash{};
+
+		int fd{ -1 };
+		uint16_t port{};
+		uint32_t remoteHost{};			// IPv4 address and port in network byte order, 0 until Connect
+		uint16_t remotePort{};
+		uint64_t lastSent{};
+
+		unsigned int latencyMs{};
+		unsigned int lossPercent{};
+		std::minstd_rand linkRandom;
+		std::deque<Delayed> delayed;
+
+		NetplayStats stats;
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include "platform.h"
+
+// Discards frames and sound and never presses a key, for running headless (with --trace or --record).
+// It quits on Ctrl+C or a termination signal.
+class NullPlatform : public Platform
+{
+	public:
+		void Update(void const*, int) override {}
+		bool ProcessInput(uint8_t*) override { return Interrupted(); }
+		void SetSound(bool) override {}
+};
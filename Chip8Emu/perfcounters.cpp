@@ -0,0 +1,201 @@
+// *********************************************************
+//
+//			   HOST PERFORMANCE COUNTERS
+//
+// *********************************************************
+
+// header inclusion
+#include "perfcounters.h"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Function to divide two counts, negative when either is missing
+double PerfSample::Ratio(PerfEvent numerator, PerfEvent denominator) const
+{
+	if (!valid[numerator] || !valid[denominator] || values[denominator] == 0) {
+		return -1.0;
+	}
+
+	return static_cast<double>(values[numerator]) / values[denominator];
+}
+
+// Function to spread a count over a number of things
+double PerfSample::Per(PerfEvent event, uint64_t count) const
+{
+	if (!valid[event] || count == 0) {
+		return -1.0;
+	}
+
+	return static_cast<double>(values[event]) / count;
+}
+
+// Function to name an event for reports
+char const* PerfCounters::Name(PerfEvent event)
+{
+	static char const* const names[PERF_EVENT_COUNT] = {
+		"cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses", "iTLB-misses", "task-clock"
+	};
+
+	return event < PERF_EVENT_COUNT ? names[event] : "?";
+}
+
+#if defined(__linux__)
+
+// perf_event_open type and config of each PerfEvent
+struct PerfEventConfig {
+	uint32_t type;
+	uint64_t config;
+};
+
+static PerfEventConfig const PERF_CONFIGS[PERF_EVENT_COUNT] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+
+// What read() returns for a counter opened with the time fields, for scaling multiplexed counts
+struct PerfReading {
+	uint64_t value;
+	uint64_t timeEnabled;
+	uint64_t timeRunning;
+};
+
+// Counters constructor declaration, opens every event it can
+PerfCounters::PerfCounters()
+{
+	int hardwareError = 0;
+
+	for (unsigned int event = 0; event < PERF_EVENT_COUNT; ++event) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_CONFIGS[event].type;
+		attr.config = PERF_CONFIGS[event].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;	// allowed at the default perf_event_paranoid of 2
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		fds[event] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+		if (fds[event] < 0 && attr.type != PERF_TYPE_SOFTWARE && hardwareError == 0) {
+			hardwareError = errno;
+		}
+	}
+
+	if (!HardwareAvailable()) {
+		problem = string("hardware counters unavailable (") + strerror(hardwareError) + ")";
+		if (hardwareError == ENOENT || hardwareError == EOPNOTSUPP) {
+			problem += ", the host exposes no PMU to this system";
+		}
+		else if (hardwareError == EACCES || hardwareError == EPERM) {
+			problem += ", lower /proc/sys/kernel/perf_event_paranoid or allow perf_event_open";
+		}
+	}
+	else {
+		for (unsigned int event = 0; event < PERF_EVENT_COUNT; ++event) {
+			if (fds[event] < 0) {
+				if (problem.empty()) {
+					problem = "not counted:";
+				}
+				problem += string(" ") + Name(static_cast<PerfEvent>(event));
+			}
+		}
+	}
+}
+
+// Counters destructor declaration
+PerfCounters::~PerfCounters()
+{
+	for (int fd : fds) {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+}
+
+// Function to zero and enable the open counters
+void PerfCounters::Start()
+{
+	for (int fd : fds) {
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+// Function to disable the counters and read them, scaled for the time each one was scheduled
+PerfSample PerfCounters::Stop()
+{
+	PerfSample sample;
+
+	for (int fd : fds) {
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+
+	for (unsigned int event = 0; event < PERF_EVENT_COUNT; ++event) {
+		PerfReading reading;
+		if (fds[event] < 0 || read(fds[event], &reading, sizeof(reading)) != static_cast<ssize_t>(sizeof(reading)) || reading.timeRunning == 0) {
+			continue;
+		}
+
+		double scale = static_cast<double>(reading.timeEnabled) / reading.timeRunning;
+		sample.values[event] = static_cast<uint64_t>(reading.value * scale);
+		sample.valid[event] = true;
+	}
+
+	return sample;
+}
+
+#else
+
+// Counters constructor declaration, there is nothing to open outside Linux
+PerfCounters::PerfCounters()
+	: problem("performance counters need Linux perf_event_open")
+{
+	for (int& fd : fds) {
+		fd = -1;
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+void PerfCounters::Start()
+{
+}
+
+PerfSample PerfCounters::Stop()
+{
+	return PerfSample();
+}
+
+#endif
+
+// Function to tell whether any hardware event is being counted
+bool PerfCounters::HardwareAvailable() const
+{
+	for (unsigned int event = 0; event < PERF_TASK_CLOCK; ++event) {
+		if (fds[event] >= 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
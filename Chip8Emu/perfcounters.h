@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Events PerfCounters tries to count, the hardware ones first
+enum PerfEvent : uint8_t {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_BRANCH_MISSES,
+	PERF_L1D_MISSES,		// level 1 data cache read misses
+	PERF_LLC_MISSES,		// last level cache misses
+	PERF_ITLB_MISSES,		// instruction TLB misses
+	PERF_TASK_CLOCK,		// nanoseconds on the CPU, a software event that works without a PMU
+	PERF_EVENT_COUNT
+};
+
+// Counts of every event over one measured stretch, scaled up when the kernel had to multiplex them
+struct PerfSample {
+	uint64_t values[PERF_EVENT_COUNT]{};
+	bool valid[PERF_EVENT_COUNT]{};
+
+	// numerator / denominator, or a negative value when either wasn't counted
+	double Ratio(PerfEvent numerator, PerfEvent denominator) const;
+
+	// event per count things, such as guest instructions, negative when it wasn't counted
+	double Per(PerfEvent event, uint64_t count) const;
+};
+
+// Counts host events for the calling thread, user space only, with Linux perf_event_open.
+// Every event is opened on its own, so one the host lacks doesn't take the others with it. In
+// containers and virtual machines without a PMU the hardware events are usually all missing and
+// only the task clock is left; everything still runs, with the missing counts reported as such.
+// On other systems nothing is available and Start and Stop do nothing.
+class PerfCounters
+{
+	public:
+		PerfCounters();
+		~PerfCounters();
+
+		PerfCounters(PerfCounters const&) = delete;
+		PerfCounters& operator=(PerfCounters const&) = delete;
+
+		bool Available(PerfEvent event) const { return fds[event] >= 0; }
+
+		// whether any of the hardware events could be opened
+		bool HardwareAvailable() const;
+
+		// why the events that couldn't be opened are missing, empty when they all opened
+		std::string const& Problem() const { return problem; }
+
+		// zeroes and starts every available counter
+		void Start();
+
+		// stops them and returns the counts since Start
+		PerfSample Stop();
+
+		static char const* Name(PerfEvent event);
+
+	private:
+		int fds[PERF_EVENT_COUNT];
+		std::string problem;
+};
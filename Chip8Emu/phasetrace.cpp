@@ -0,0 +1,164 @@
+// *********************************************************
+//
+//			     HOST PHASE TRACING
+//
+// *********************************************************
+
+// header inclusion
+#include "phasetrace.h"
+
+#ifdef CHIP8_PHASE_TRACING
+
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// One finished span
+struct PhaseEvent {
+	char const* name;
+	uint64_t start;
+	uint64_t duration;
+};
+
+// The spans of one thread. Only the owning thread writes, a dump reads up to written
+struct PhaseBuffer {
+	unique_ptr<PhaseEvent[]> events;
+	atomic<uint64_t> written{};
+	unsigned int tid;
+	string name;
+};
+
+// every thread's buffer, kept after the thread ends so its spans still get dumped
+static mutex buffersLock;
+static vector<unique_ptr<PhaseBuffer>> buffers;
+static uint64_t startTime;
+
+static thread_local PhaseBuffer* localBuffer = nullptr;
+
+static volatile sig_atomic_t dumpRequested = 0;
+
+#ifndef _WIN32
+// Function run on SIGUSR1
+static void OnDumpSignal(int)
+{
+	dumpRequested = 1;
+}
+#endif
+
+// Function to get the calling thread's buffer, allocating it on the thread's first span
+static PhaseBuffer& LocalBuffer()
+{
+	if (!localBuffer) {
+		unique_ptr<PhaseBuffer> buffer = make_unique<PhaseBuffer>();
+		buffer->events = make_unique<PhaseEvent[]>(PHASE_EVENTS_PER_THREAD);
+
+		lock_guard<mutex> lock(buffersLock);
+		buffer->tid = static_cast<unsigned int>(buffers.size()) + 1;
+		buffer->name = "thread " + to_string(buffer->tid);
+		localBuffer = buffer.get();
+		buffers.push_back(std::move(buffer));
+	}
+
+	return *localBuffer;
+}
+
+// Function to start recording spans
+void PhaseTracer::Start()
+{
+	startTime = Now();
+	NameThread("host");
+
+#ifndef _WIN32
+	std::signal(SIGUSR1, OnDumpSignal);
+#endif
+
+	enabled.store(true, memory_order_relaxed);
+}
+
+// Function to name the calling thread in the trace
+void PhaseTracer::NameThread(char const* name)
+{
+	PhaseBuffer& buffer = LocalBuffer();
+
+	lock_guard<mutex> lock(buffersLock);
+	buffer.name = name;
+}
+
+// Function to tell the host loop once that a dump was asked for
+bool PhaseTracer::TakeDumpRequest()
+{
+	if (dumpRequested == 0) {
+		return false;
+	}
+
+	dumpRequested = 0;
+	return true;
+}
+
+// Function to record a finished span, overwriting the oldest one when the ring is full
+void PhaseTracer::Record(char const* name, uint64_t start, uint64_t end)
+{
+	PhaseBuffer& buffer = LocalBuffer();
+	uint64_t written = buffer.written.load(memory_order_relaxed);
+
+	buffer.events[written % PHASE_EVENTS_PER_THREAD] = { name, start, end - start };
+	buffer.written.store(written + 1, memory_order_release);
+}
+
+// Function to get the calling thread's span count, for Rewind
+uint64_t PhaseTracer::Mark()
+{
+	return LocalBuffer().written.load(memory_order_relaxed);
+}
+
+// Function to drop the spans the calling thread recorded since a mark
+void PhaseTracer::Rewind(uint64_t mark)
+{
+	LocalBuffer().written.store(mark, memory_order_release);
+}
+
+// Function to write every buffer as Chrome trace complete events, microseconds since Start
+bool PhaseTracer::Dump(char const* filename)
+{
+	ofstream file(filename);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	lock_guard<mutex> lock(buffersLock);
+	char const* separator = "";
+	char line[256];
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	for (unique_ptr<PhaseBuffer> const& buffer : buffers) {
+		file << separator << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+			<< ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+		separator = ",";
+
+		uint64_t written = buffer->written.load(memory_order_acquire);
+		uint64_t first = written > PHASE_EVENTS_PER_THREAD ? written - PHASE_EVENTS_PER_THREAD : 0;
+
+		for (uint64_t i = first; i < written; ++i) {
+			PhaseEvent const& event = buffer->events[i % PHASE_EVENTS_PER_THREAD];
+			if (event.start < startTime) {
+				continue;
+			}
+
+			snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				event.name, buffer->tid, (event.start - startTime) / 1000.0, event.duration / 1000.0);
+			file << line;
+		}
+	}
+
+	file << "\n]}\n";
+	return file.good();
+}
+
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Host phase tracing: scoped spans around the phases of the host loop (input, emulation, texture
+// upload, present), written to a Chrome trace JSON file that chrome://tracing and Perfetto open.
+// Each thread records into its own ring of PHASE_EVENTS_PER_THREAD spans, allocated once on the
+// thread's first span, so recording is two clock reads and a store with no lock or allocation;
+// when a ring is full the oldest spans are overwritten.
+// Built only with CHIP8_PHASE_TRACING defined. Without it PhaseSpan and PhaseFrame are empty and
+// every span compiles to nothing; with it a span costs one relaxed load until Start is called.
+
+const size_t PHASE_EVENTS_PER_THREAD = 1 << 18;
+
+#ifdef CHIP8_PHASE_TRACING
+#include <atomic>
+#include <chrono>
+
+class PhaseTracer
+{
+	public:
+		// starts recording on every thread, the calling thread is named "host"
+		static void Start();
+
+		static bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+		// writes the spans recorded so far as a Chrome trace, false if the file can't be written.
+		// Other threads keep recording meanwhile, a span one of them overwrites during the dump may come out garbled
+		static bool Dump(char const* filename);
+
+		// names the calling thread in the trace
+		static void NameThread(char const* name);
+
+		// true once after SIGUSR1 arrived, for the host loop to dump without stopping (POSIX only)
+		static bool TakeDumpRequest();
+
+		// steady clock nanoseconds
+		static uint64_t Now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// records a finished span on the calling thread, name must outlive the tracer
+		static void Record(char const* name, uint64_t start, uint64_t end);
+
+		// spans recorded by the calling thread so far, and dropping the ones after a mark
+		static uint64_t Mark();
+		static void Rewind(uint64_t mark);
+
+	private:
+		static inline std::atomic<bool> enabled{};
+};
+
+// Records the time from its construction to the end of its scope as a span called name
+class PhaseSpan
+{
+	public:
+		explicit PhaseSpan(char const* name)
+		{
+			if (PhaseTracer::Enabled()) {
+				spanName = name;
+				start = PhaseTracer::Now();
+			}
+		}
+
+		~PhaseSpan()
+		{
+			if (spanName) {
+				PhaseTracer::Record(spanName, start, PhaseTracer::Now());
+			}
+		}
+
+		PhaseSpan(PhaseSpan const&) = delete;
+		PhaseSpan& operator=(PhaseSpan const&) = delete;
+
+	private:
+		char const* spanName{};
+		uint64_t start{};
+};
+
+// A span around one pass of a loop that often has nothing to do. Discard drops it and every span
+// recorded inside it, so idle passes don't push the frames that did work out of the ring
+class PhaseFrame
+{
+	public:
+		explicit PhaseFrame(char const* name)
+		{
+			if (PhaseTracer::Enabled()) {
+				spanName = name;
+				mark = PhaseTracer::Mark();
+				start = PhaseTracer::Now();
+			}
+		}
+
+		~PhaseFrame()
+		{
+			if (spanName) {
+				PhaseTracer::Record(spanName, start, PhaseTracer::Now());
+			}
+		}
+
+		void Discard()
+		{
+			if (spanName) {
+				PhaseTracer::Rewind(mark);
+				spanName = nullptr;
+			}
+		}
+
+		PhaseFrame(PhaseFrame const&) = delete;
+		PhaseFrame& operator=(PhaseFrame const&) = delete;
+
+	private:
+		char const* spanName{};
+		uint64_t mark{};
+		uint64_t start{};
+};
+
+#else
+
+class PhaseSpan
+{
+	public:
+		explicit PhaseSpan(char const*) {}
+};
+
+class PhaseFrame
+{
+	public:
+		explicit PhaseFrame(char const*) {}
+		void Discard() {}
+};
+
+#endif
@@ -1,227 +1,74 @@
-#include "platform.h"
-#include <SDL.h>
+// *********************************************************
+//
+//				  PLATFORM BACKEND SELECTION
+//
+// *********************************************************
 
-Platform::Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight)
-{
-	SDL_Init(SDL_INIT_VIDEO);
+#include "platform.h"
+#include "nullplatform.h"
+#include <csignal>
 
-	window = SDL_CreateWindow(title, 0, 0, windowWidth, windowHeight, SDL_WINDOW_SHOWN);
+#ifndef CHIP8_NO_SDL
+#include "sdlplatform.h"
+#endif
 
-	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+#ifndef _WIN32
+#include "terminalplatform.h"
+#endif
 
-	texture = SDL_CreateTexture(
-		renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
-}
-
-Platform::~Platform()
-{
-	SDL_DestroyTexture(texture);
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(window);
-	SDL_Quit();
-}
+static volatile std::sig_atomic_t interrupted = 0;
 
-void Platform::Update(void const* buffer, int pitch)
+// Function run on Ctrl+C or a termination request
+static void OnInterrupt(int)
 {
-	SDL_UpdateTexture(texture, nullptr, buffer, pitch);
-	SDL_RenderClear(renderer);
-	SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-	SDL_RenderPresent(renderer);
+	interrupted = 1;
 }
 
-bool Platform::ProcessInput(uint8_t* keys)
+// Function to report whether the process was asked to stop, catching the signals on first use
+bool Platform::Interrupted()
 {
-	bool quit = false;
+	static bool catching = false;
 
-	SDL_Event event;
-
-	while (SDL_PollEvent(&event))
+	if (!catching)
 	{
-		switch (event.type)
-		{
-		case SDL_QUIT:
-		{
-			quit = true;
-		} break;
-
-		case SDL_KEYDOWN:
-		{
-			switch (event.key.keysym.sym)
-			{
-			case SDLK_ESCAPE:
-			{
-				quit = true;
-			} break;
-
-			case SDLK_x:
-			{
-				keys[0] = 1;
-			} break;
-
-			case SDLK_1:
-			{
-				keys[1] = 1;
-			} break;
-
-			case SDLK_2:
-			{
-				keys[2] = 1;
-			} break;
-
-			case SDLK_3:
-			{
-				keys[3] = 1;
-			} break;
-
-			case SDLK_q:
-			{
-				keys[4] = 1;
-			} break;
-
-			case SDLK_w:
-			{
-				keys[5] = 1;
-			} break;
-
-			case SDLK_e:
-			{
-				keys[6] = 1;
-			} break;
-
-			case SDLK_a:
-			{
-				keys[7] = 1;
-			} break;
-
-			case SDLK_s:
-			{
-				keys[8] = 1;
-			} break;
-
-			case SDLK_d:
-			{
-				keys[9] = 1;
-			} break;
-
-			case SDLK_z:
-			{
-				keys[0xA] = 1;
-			} break;
-
-			case SDLK_c:
-			{
-				keys[0xB] = 1;
-			} break;
-
-			case SDLK_4:
-			{
-				keys[0xC] = 1;
-			} break;
-
-			case SDLK_r:
-			{
-				keys[0xD] = 1;
-			} break;
-
-			case SDLK_f:
-			{
-				keys[0xE] = 1;
-			} break;
-
-			case SDLK_v:
-			{
-				keys[0xF] = 1;
-			} break;
-			}
-		} break;
-
-		case SDL_KEYUP:
-		{
-			switch (event.key.keysym.sym)
-			{
-			case SDLK_x:
-			{
-				keys[0] = 0;
-			} break;
-
-			case SDLK_1:
-			{
-				keys[1] = 0;
-			} break;
-
-			case SDLK_2:
-			{
-				keys[2] = 0;
-			} break;
-
-			case SDLK_3:
-			{
-				keys[3] = 0;
-			} break;
-
-			case SDLK_q:
-			{
-				keys[4] = 0;
-			} break;
-
-			case SDLK_w:
-			{
-				keys[5] = 0;
-			} break;
-
-			case SDLK_e:
-			{
-				keys[6] = 0;
-			} break;
-
-			case SDLK_a:
-			{
-				keys[7] = 0;
-			} break;
-
-			case SDLK_s:
-			{
-				keys[8] = 0;
-			} break;
-
-			case SDLK_d:
-			{
-				keys[9] = 0;
-			} break;
-
-			case SDLK_z:
-			{
-				keys[0xA] = 0;
-			} break;
-
-			case SDLK_c:
-			{
-				keys[0xB] = 0;
-			} break;
+		catching = true;
+		std::signal(SIGINT, OnInterrupt);
+		std::signal(SIGTERM, OnInterrupt);
+	}
 
-			case SDLK_4:
-			{
-				keys[0xC] = 0;
-			} break;
+	return interrupted != 0;
+}
 
-			case SDLK_r:
-			{
-				keys[0xD] = 0;
-			} break;
+std::unique_ptr<Platform> CreatePlatform(std::string const& name, [[maybe_unused]] char const* title,
+	[[maybe_unused]] int windowWidth, [[maybe_unused]] int windowHeight, int textureWidth, int textureHeight)
+{
+	if (name == "null")
+	{
+		return std::make_unique<NullPlatform>();
+	}
 
-			case SDLK_f:
-			{
-				keys[0xE] = 0;
-			} break;
+#ifndef CHIP8_NO_SDL
+	if (name == "sdl")
+	{
+		return std::make_unique<SdlPlatform>(title, windowWidth, windowHeight, textureWidth, textureHeight);
+	}
+#endif
 
-			case SDLK_v:
-			{
-				keys[0xF] = 0;
-			} break;
-			}
-		} break;
-		}
+#ifndef _WIN32
+	if (name == "terminal")
+	{
+		return std::make_unique<TerminalPlatform>(textureWidth, textureHeight);
 	}
+#endif
+
+	return nullptr;
+}
 
-	return quit;
-}
\ No newline at end of file
+char const* DefaultPlatform()
+{
+#ifndef CHIP8_NO_SDL
+	return "sdl";
+#else
+	return "terminal";
+#endif
+}
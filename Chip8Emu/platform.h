@@ -1,27 +1,39 @@
 #pragma once
 #include <cstdint>
+#include <memory>
+#include <string>
 
-class SDL_Window;
-class SDL_Renderer;
-class SDL_Texture;
-
+// Video, input and audio for the emulator. Each backend is its own subclass, made by CreatePlatform,
+// so the core and the headless backends build without SDL.
 class Platform
 {
 	public:
-		// constructor
-		Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeigh);
-		
-		// update function
-		void Update(void const* buffer, int pitch);
-		
-		// input for keys function
-		bool ProcessInput(uint8_t* keys);
-		
-		// destructor
-		~Platform();
-
-	private:
-		SDL_Window* window{};
-		SDL_Renderer* renderer{};
-		SDL_Texture* texture{};
-};
\ No newline at end of file
+		virtual ~Platform() = default;
+
+		// draws a frame of 32-bit pixels (0 is off), pitch bytes apart per row
+		virtual void Update(void const* buffer, int pitch) = 0;
+
+		// reads pending input into the 16 keys, returns true when the user asked to quit
+		virtual bool ProcessInput(uint8_t* keys) = 0;
+
+		// turns the buzzer on or off, called with the sound timer state every loop
+		virtual void SetSound(bool on) = 0;
+
+		// fast-forward state, toggled with the Tab key
+		bool FastForward() const { return fastForward; }
+		void SetFastForward(bool enabled) { fastForward = enabled; }
+
+	protected:
+		// true once Ctrl+C or a termination signal arrived, the only way to stop a headless backend
+		static bool Interrupted();
+
+		bool fastForward{};
+};
+
+// Creates the backend called name: "sdl" (a window), "terminal" (Unicode half-blocks on an ANSI
+// terminal) or "null" (no output). Returns nullptr for a backend this build doesn't have
+std::unique_ptr<Platform> CreatePlatform(std::string const& name, char const* title,
+	int windowWidth, int windowHeight, int textureWidth, int textureHeight);
+
+// The backend used when none is asked for: SDL where it was built in, the terminal otherwise
+char const* DefaultPlatform();
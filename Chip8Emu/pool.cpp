@@ -0,0 +1,54 @@
+// *********************************************************
+//
+//				  CHIP 8 INSTANCE POOL
+//
+// *********************************************************
+
+// Libraries
+#include "pool.h"
+#include <new>
+#include <type_traits>
+
+using namespace std;
+
+// blocks are freed without running destructors on the machines still in them
+static_assert(std::is_trivially_destructible<Chip8>::value, "Chip8 must not own resources");
+
+// Function to create an empty pool
+Chip8Pool::Chip8Pool(unsigned int instancesPerBlock)
+	: instancesPerBlock(instancesPerBlock > 0 ? instancesPerBlock : 1)
+{
+}
+
+// Function to construct a machine in a free slot
+Chip8* Chip8Pool::Acquire()
+{
+	if (freeSlots.empty()) {
+		// left uninitialized, each slot is constructed when it is handed out
+		blocks.emplace_back(new Slot[instancesPerBlock]);
+		Slot* block = blocks.back().get();
+
+		// pushed in reverse so slots are handed out in address order
+		for (unsigned int i = instancesPerBlock; i > 0; --i) {
+			freeSlots.push_back(&block[i - 1]);
+		}
+	}
+
+	Slot* slot = freeSlots.back();
+	freeSlots.pop_back();
+	++live;
+
+	return new (slot->bytes) Chip8();
+}
+
+// Function to return a machine to the pool
+void Chip8Pool::Release(Chip8* chip8)
+{
+	if (chip8 == nullptr) {
+		return;
+	}
+
+	chip8->~Chip8();
+	freeSlots.push_back(reinterpret_cast<Slot*>(chip8));
+	--live;
+}
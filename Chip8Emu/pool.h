@@ -0,0 +1,40 @@
+#pragma once
+#include "chip8.h"
+#include <memory>
+#include <vector>
+
+// Hands out Chip8 instances from large blocks, so tens of thousands of machines sit densely in
+// memory instead of being scattered over the heap. Released instances go on a free list and are
+// the first to be handed out again, while their memory is still cached.
+class Chip8Pool
+{
+	public:
+		// instancesPerBlock machines are allocated together each time the pool runs out
+		explicit Chip8Pool(unsigned int instancesPerBlock = 256);
+
+		Chip8Pool(Chip8Pool const&) = delete;
+		Chip8Pool& operator=(Chip8Pool const&) = delete;
+
+		// constructs a machine in a free slot, growing the pool by a block if there is none
+		Chip8* Acquire();
+
+		// returns a machine from Acquire to the pool
+		void Release(Chip8* chip8);
+
+		size_t Live() const { return live; }
+		size_t Capacity() const { return blocks.size() * instancesPerBlock; }
+
+		// bytes of pool memory each machine occupies
+		static constexpr size_t SlotSize() { return sizeof(Slot); }
+
+	private:
+		// raw storage for one machine, aligned like Chip8 so its cache line split is kept
+		struct alignas(Chip8) Slot {
+			unsigned char bytes[sizeof(Chip8)];
+		};
+
+		unsigned int instancesPerBlock;
+		size_t live{};
+		std::vector<std::unique_ptr<Slot[]>> blocks;
+		std::vector<Slot*> freeSlots;
+};
@@ -0,0 +1,157 @@
+// *********************************************************
+//
+//			  COOPERATIVE MULTI-MACHINE SCHEDULER
+//
+// *********************************************************
+
+// Libraries
+#include "scheduler.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// Function to create a scheduler emulating cyclesPerFrame instructions per frame
+Scheduler::Scheduler(unsigned int cyclesPerFrame)
+	: cyclesPerFrame(std::max(1u, cyclesPerFrame))
+{
+}
+
+// Function to destroy every session and give its machine back to the pool
+Scheduler::~Scheduler()
+{
+	for (auto& session : sessions) {
+		session->task = Task{ nullptr };
+		pool.Release(session->chip8);
+	}
+}
+
+// Function to add a machine running a ROM
+unsigned int Scheduler::AddSession(char const* romFilename)
+{
+	sessions.push_back(std::make_unique<Session>());
+	Session& session = *sessions.back();
+
+	session.id = static_cast<unsigned int>(sessions.size() - 1);
+	session.chip8 = pool.Acquire();
+	session.chip8->SeedRandom(session.id);
+	session.chip8->LoadROM(romFilename);
+	session.lastFrame = frame;
+	session.task = RunSession(session);
+
+	// the coroutine starts suspended and runs its first frame on the next RunFrame
+	ready.push_back(&session);
+	return session.id;
+}
+
+// Function to hand a session its keys, waking it if it was waiting for them
+void Scheduler::SetKeys(unsigned int session, uint8_t const* keys)
+{
+	Session& target = *sessions[session];
+
+	if (memcmp(target.keys, keys, KEY_COUNT) == 0) {
+		return;
+	}
+	memcpy(target.keys, keys, KEY_COUNT);
+
+	// sleeping sessions are in a delay-timer poll, which doesn't read keys, so they pick them up on time
+	if (target.state == SESSION_WAITING) {
+		target.state = SESSION_READY;
+		ready.push_back(&target);
+	}
+}
+
+// Function to put a session in the timer wheel
+void Scheduler::Schedule(Session& session, uint64_t frames)
+{
+	session.state = SESSION_SLEEPING;
+	session.due = frame + frames;
+	wheel[session.due % WHEEL_SLOTS].push_back(&session);
+}
+
+// Function to resume a session's coroutine
+void Scheduler::Resume(Session& session)
+{
+	++resumes;
+	session.task.handle.resume();
+}
+
+// Function to advance every session by one frame
+void Scheduler::RunFrame()
+{
+	++frame;
+
+	// sessions due this frame, the rest of the slot is a later lap of the wheel
+	vector<Session*> due;
+	due.swap(wheel[frame % WHEEL_SLOTS]);
+	for (Session* session : due) {
+		if (session->due == frame) {
+			Resume(*session);
+		}
+		else {
+			wheel[frame % WHEEL_SLOTS].push_back(session);
+		}
+	}
+
+	// sessions woken by keys or just added
+	vector<Session*> woken;
+	woken.swap(ready);
+	for (Session* session : woken) {
+		Resume(*session);
+	}
+}
+
+// Function to run the frames a session slept through
+void Scheduler::CatchUp(Session& session, uint64_t through)
+{
+	// replayed with the keys the machine had, it wasn't reading them
+	while (session.lastFrame < through) {
+		uint64_t frames = std::min<uint64_t>(through - session.lastFrame, CATCH_UP_FRAMES);
+		session.chip8->RunCycles(static_cast<unsigned int>(frames * cyclesPerFrame));
+		session.lastFrame += frames;
+	}
+}
+
+// Function to bring a session's machine up to the current frame
+Chip8 const& Scheduler::Machine(unsigned int session)
+{
+	Session& target = *sessions[session];
+	CatchUp(target, frame);
+	return *target.chip8;
+}
+
+// Function that is the body of every session, one loop per emulated frame
+Scheduler::Task Scheduler::RunSession(Session& session)
+{
+	Chip8& chip8 = *session.chip8;
+
+	while (true) {
+		CatchUp(session, frame - 1);
+
+		memcpy(chip8.keys, session.keys, KEY_COUNT);
+		chip8.RunCycles(cyclesPerFrame);
+		session.lastFrame = frame;
+
+		if (onFrame) {
+			onFrame(session.id, chip8);
+		}
+
+		// yield until the next point where the machine can do something new
+		unsigned int idleInstructions;
+		switch (chip8.Waiting(idleInstructions)) {
+		case WAIT_KEY:
+		case WAIT_HALTED:
+			co_await WaitForKeys{ session };
+			break;
+
+		case WAIT_DELAY_TIMER:
+			// only whole frames spent polling can be skipped
+			co_await Sleep{ *this, session, std::max(1u, idleInstructions / cyclesPerFrame) };
+			break;
+
+		default:
+			co_await Sleep{ *this, session, 1 };
+			break;
+		}
+	}
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "chip8.h"
+#include "pool.h"
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Runs many machines cooperatively on one thread. Each machine is a coroutine that emulates one
+// frame (cyclesPerFrame instructions through RunCycles) and then yields until its next natural
+// resume point: the next frame, the frame a delay-timer poll is certain to still be running in,
+// or a key change while it waits in Fx0A or has halted. Sleeping machines sit in a timer wheel and
+// waiting ones aren't looked at until SetKeys wakes them, so one thread can serve hundreds of mostly
+// idle sessions.
+// A resumed machine first replays the frames it slept through. The fused idle loops in RunCycles
+// make that cheap, and every session ends up exactly where stepping it every frame would have.
+class Scheduler
+{
+	public:
+		explicit Scheduler(unsigned int cyclesPerFrame);
+		~Scheduler();
+
+		Scheduler(Scheduler const&) = delete;
+		Scheduler& operator=(Scheduler const&) = delete;
+
+		// adds a machine running romFilename, returns its session number
+		// (the machine's random generator is seeded with it, so runs can be reproduced)
+		unsigned int AddSession(char const* romFilename);
+
+		// hands a session its key states, in the layout Platform::ProcessInput fills in,
+		// and wakes it if it was waiting for them
+		void SetKeys(unsigned int session, uint8_t const* keys);
+
+		// called for every session that emulated a frame, right after it did
+		void OnFrame(std::function<void(unsigned int, Chip8 const&)> callback) { onFrame = std::move(callback); }
+
+		// advances every session by one frame, resuming only the ones due
+		void RunFrame();
+
+		// returns a session's machine as of the current frame, replaying any frames it slept through
+		Chip8 const& Machine(unsigned int session);
+
+		unsigned int Sessions() const { return static_cast<unsigned int>(sessions.size()); }
+		uint64_t Frame() const { return frame; }
+
+		// coroutine resumptions so far, against Frame() * Sessions() for stepping every machine
+		uint64_t Resumes() const { return resumes; }
+
+	private:
+		static const unsigned int WHEEL_SLOTS = 256;
+
+		// most frames a catch-up replays per RunCycles call
+		static const unsigned int CATCH_UP_FRAMES = 4096;
+
+		// Coroutine handle of a running session, destroyed with it
+		struct Task {
+			struct promise_type {
+				Task get_return_object() { return Task{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+				std::suspend_always initial_suspend() noexcept { return {}; }
+				std::suspend_always final_suspend() noexcept { return {}; }
+				void return_void() {}
+				void unhandled_exception() { std::terminate(); }
+			};
+
+			explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+			Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+			~Task() { if (handle) handle.destroy(); }
+
+			Task& operator=(Task&& other) noexcept
+			{
+				std::swap(handle, other.handle);
+				return *this;
+			}
+
+			std::coroutine_handle<promise_type> handle;
+		};
+
+		enum SessionState : uint8_t {
+			SESSION_READY,		// resumes on the next RunFrame
+			SESSION_SLEEPING,	// in the timer wheel until frame due
+			SESSION_WAITING		// parked until SetKeys changes its keys
+		};
+
+		struct Session {
+			unsigned int id;
+			Chip8* chip8;
+			uint8_t keys[KEY_COUNT]{};	// latest keys from the host, applied when the session runs
+			uint64_t lastFrame;			// last frame the machine emulated
+			uint64_t due{};
+			SessionState state{ SESSION_READY };
+			Task task{ nullptr };
+		};
+
+		// Suspends a session for a number of frames
+		struct Sleep {
+			Scheduler& scheduler;
+			Session& session;
+			uint64_t frames;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<>) { scheduler.Schedule(session, frames); }
+			void await_resume() const noexcept {}
+		};
+
+		// Suspends a session until its keys change
+		struct WaitForKeys {
+			Session& session;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<>) { session.state = SESSION_WAITING; }
+			void await_resume() const noexcept {}
+		};
+
+		// the body of every session
+		Task RunSession(Session& session);
+
+		// puts a session in the timer wheel
+		void Schedule(Session& session, uint64_t frames);
+
+		// resumes a session's coroutine
+		void Resume(Session& session);
+
+		// runs the frames a session slept through, up to and including frame through
+		void CatchUp(Session& session, uint64_t through);
+
+		unsigned int cyclesPerFrame;
+		uint64_t frame{};
+		uint64_t resumes{};
+
+		Chip8Pool pool;
+		std::vector<std::unique_ptr<Session>> sessions;
+		std::vector<Session*> wheel[WHEEL_SLOTS];
+		std::vector<Session*> ready;
+		std::function<void(unsigned int, Chip8 const&)> onFrame;
+};
@@ -0,0 +1,294 @@
+// *********************************************************
+//
+//				  SDL WINDOW PLATFORM BACKEND
+//
+// *********************************************************
+
+#include "sdlplatform.h"
+#include "phasetrace.h"
+#include <SDL.h>
+
+// buzzer pitch and volume
+const int BEEP_FREQUENCY = 440;
+const int BEEP_SAMPLE_RATE = 44100;
+const int16_t BEEP_AMPLITUDE = 3000;
+
+SdlPlatform::SdlPlatform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight)
+{
+	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
+
+	window = SDL_CreateWindow(title, 0, 0, windowWidth, windowHeight, SDL_WINDOW_SHOWN);
+
+	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+
+	texture = SDL_CreateTexture(
+		renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
+
+	// a square wave, paused until the sound timer runs; a machine without audio just stays silent
+	SDL_AudioSpec wanted{};
+	wanted.freq = BEEP_SAMPLE_RATE;
+	wanted.format = AUDIO_S16SYS;
+	wanted.channels = 1;
+	wanted.samples = 512;
+	wanted.callback = &SdlPlatform::FillAudio;
+	wanted.userdata = this;
+	audio = SDL_OpenAudioDevice(nullptr, 0, &wanted, nullptr, 0);
+}
+
+SdlPlatform::~SdlPlatform()
+{
+	if (audio)
+	{
+		SDL_CloseAudioDevice(audio);
+	}
+	SDL_DestroyTexture(texture);
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+}
+
+void SdlPlatform::Update(void const* buffer, int pitch)
+{
+	{
+		PhaseSpan span("SDL_UpdateTexture");
+		SDL_UpdateTexture(texture, nullptr, buffer, pitch);
+	}
+
+	{
+		PhaseSpan span("SDL_RenderCopy");
+		SDL_RenderClear(renderer);
+		SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+	}
+
+	PhaseSpan span("SDL_RenderPresent");
+	SDL_RenderPresent(renderer);
+}
+
+void SdlPlatform::SetSound(bool on)
+{
+	if (audio && on != sounding)
+	{
+		sounding = on;
+		SDL_PauseAudioDevice(audio, on ? 0 : 1);
+	}
+}
+
+// Function called by SDL on its audio thread to fill a buffer with the square wave
+void SdlPlatform::FillAudio(void* userdata, uint8_t* stream, int length)
+{
+	SdlPlatform* platform = static_cast<SdlPlatform*>(userdata);
+	int16_t* samples = reinterpret_cast<int16_t*>(stream);
+	int halfPeriod = BEEP_SAMPLE_RATE / BEEP_FREQUENCY / 2;
+
+	for (int i = 0; i < length / 2; i++)
+	{
+		samples[i] = (platform->beepPhase / halfPeriod) % 2 ? BEEP_AMPLITUDE : -BEEP_AMPLITUDE;
+		platform->beepPhase = (platform->beepPhase + 1) % (2 * halfPeriod);
+	}
+}
+
+bool SdlPlatform::ProcessInput(uint8_t* keys)
+{
+	bool quit = Interrupted();
+
+	SDL_Event event;
+
+	while (SDL_PollEvent(&event))
+	{
+		switch (event.type)
+		{
+		case SDL_QUIT:
+		{
+			quit = true;
+		} break;
+
+		case SDL_KEYDOWN:
+		{
+			switch (event.key.keysym.sym)
+			{
+			case SDLK_ESCAPE:
+			{
+				quit = true;
+			} break;
+
+			case SDLK_TAB:
+			{
+				// ignore auto-repeat so holding Tab doesn't flicker between modes
+				if (!event.key.repeat)
+				{
+					fastForward = !fastForward;
+				}
+			} break;
+
+			case SDLK_x:
+			{
+				keys[0] = 1;
+			} break;
+
+			case SDLK_1:
+			{
+				keys[1] = 1;
+			} break;
+
+			case SDLK_2:
+			{
+				keys[2] = 1;
+			} break;
+
+			case SDLK_3:
+			{
+				keys[3] = 1;
+			} break;
+
+			case SDLK_q:
+			{
+				keys[4] = 1;
+			} break;
+
+			case SDLK_w:
+			{
+				keys[5] = 1;
+			} break;
+
+			case SDLK_e:
+			{
+				keys[6] = 1;
+			} break;
+
+			case SDLK_a:
+			{
+				keys[7] = 1;
+			} break;
+
+			case SDLK_s:
+			{
+				keys[8] = 1;
+			} break;
+
+			case SDLK_d:
+			{
+				keys[9] = 1;
+			} break;
+
+			case SDLK_z:
+			{
+				keys[0xA] = 1;
+			} break;
+
+			case SDLK_c:
+			{
+				keys[0xB] = 1;
+			} break;
+
+			case SDLK_4:
+			{
+				keys[0xC] = 1;
+			} break;
+
+			case SDLK_r:
+			{
+				keys[0xD] = 1;
+			} break;
+
+			case SDLK_f:
+			{
+				keys[0xE] = 1;
+			} break;
+
+			case SDLK_v:
+			{
+				keys[0xF] = 1;
+			} break;
+			}
+		} break;
+
+		case SDL_KEYUP:
+		{
+			switch (event.key.keysym.sym)
+			{
+			case SDLK_x:
+			{
+				keys[0] = 0;
+			} break;
+
+			case SDLK_1:
+			{
+				keys[1] = 0;
+			} break;
+
+			case SDLK_2:
+			{
+				keys[2] = 0;
+			} break;
+
+			case SDLK_3:
+			{
+				keys[3] = 0;
+			} break;
+
+			case SDLK_q:
+			{
+				keys[4] = 0;
+			} break;
+
+			case SDLK_w:
+			{
+				keys[5] = 0;
+			} break;
+
+			case SDLK_e:
+			{
+				keys[6] = 0;
+			} break;
+
+			case SDLK_a:
+			{
+				keys[7] = 0;
+			} break;
+
+			case SDLK_s:
+			{
+				keys[8] = 0;
+			} break;
+
+			case SDLK_d:
+			{
+				keys[9] = 0;
+			} break;
+
+			case SDLK_z:
+			{
+				keys[0xA] = 0;
+			} break;
+
+			case SDLK_c:
+			{
+				keys[0xB] = 0;
+			} break;
+
+			case SDLK_4:
+			{
+				keys[0xC] = 0;
+			} break;
+
+			case SDLK_r:
+			{
+				keys[0xD] = 0;
+			} break;
+
+			case SDLK_f:
+			{
+				keys[0xE] = 0;
+			} break;
+
+			case SDLK_v:
+			{
+				keys[0xF] = 0;
+			} break;
+			}
+		} break;
+		}
+	}
+
+	return quit;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "platform.h"
+
+class SDL_Window;
+class SDL_Renderer;
+class SDL_Texture;
+
+// Draws the display scaled up in a window, reads the keyboard and beeps through SDL
+class SdlPlatform : public Platform
+{
+	public:
+		// constructor
+		SdlPlatform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight);
+
+		// update function
+		void Update(void const* buffer, int pitch) override;
+
+		// input for keys function
+		bool ProcessInput(uint8_t* keys) override;
+
+		// buzzer function
+		void SetSound(bool on) override;
+
+		// destructor
+		~SdlPlatform() override;
+
+	private:
+		static void FillAudio(void* userdata, uint8_t* stream, int length);
+
+		SDL_Window* window{};
+		SDL_Renderer* renderer{};
+		SDL_Texture* texture{};
+		uint32_t audio{};		// audio device, 0 if none could be opened
+		bool sounding{};
+		int beepPhase{};		// sample position in the square wave, audio thread only
+};
@@ -0,0 +1,126 @@
+// *********************************************************
+//
+//			   SHARED MEMORY STATE EXPORT
+//
+// *********************************************************
+
+// header inclusion
+#include "sharedexport.h"
+#include "debugger.h"
+#include <new>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+
+// Exporter constructor declaration
+SharedStateExporter::SharedStateExporter(char const* name, unsigned int instances)
+	: name(name), instances(instances)
+{
+	// a region left behind by a crashed run would have the wrong size or stale readers
+	shm_unlink(name);
+
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0) {
+		return;
+	}
+
+	// the header gets a slot's worth of space so the slots stay cache-line aligned
+	size = sizeof(SharedSlot) * (static_cast<size_t>(instances) + 1);
+	void* mapped = ftruncate(fd, size) == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	if (mapped == MAP_FAILED) {
+		shm_unlink(name);
+		return;
+	}
+
+	region = mapped;
+	slots = static_cast<SharedSlot*>(mapped) + 1;
+	for (unsigned int i = 0; i < instances; i++) {
+		new (&slots[i]) SharedSlot{};
+	}
+
+	// the header goes in last, a reader that sees the magic sees initialised slots
+	SharedHeader* header = static_cast<SharedHeader*>(mapped);
+	header->instances = instances;
+	header->slotSize = sizeof(SharedSlot);
+	header->version = SHARED_VERSION;
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = SHARED_MAGIC;
+}
+
+// Exporter destructor declaration
+SharedStateExporter::~SharedStateExporter()
+{
+	if (region) {
+		munmap(region, size);
+		shm_unlink(name.c_str());
+	}
+}
+
+#else
+
+SharedStateExporter::SharedStateExporter(char const* name, unsigned int instances) : name(name), instances(instances) {}
+SharedStateExporter::~SharedStateExporter() {}
+
+#endif
+
+// Function to publish a machine's state
+void SharedStateExporter::Publish(unsigned int instance, Chip8 const& chip8)
+{
+	Debugger::Registers registers = Debugger::ReadRegisters(chip8);
+	SharedSnapshot snapshot;
+
+	for (unsigned int i = 0; i < REGISTER_COUNT; i++) {
+		snapshot.v[i] = registers.v[i];
+	}
+	snapshot.index = registers.index;
+	snapshot.pc = registers.pc;
+	snapshot.sp = registers.sp;
+	snapshot.delay = registers.delay;
+	snapshot.sound = registers.sound;
+	snapshot.fault = chip8.GetFault();
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; row++) {
+		snapshot.rows[row] = chip8.display[row];
+	}
+
+	Publish(instance, snapshot);
+}
+
+// Function to write a snapshot into an instance's slot under its seqlock
+void SharedStateExporter::Publish(unsigned int instance, SharedSnapshot const& snapshot)
+{
+	if (!slots || instance >= instances) {
+		return;
+	}
+
+	SharedSlot& slot = slots[instance];
+	uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+	// odd: readers that start now retry, and the fence keeps the stores below after it
+	slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (unsigned int word = 0; word < 2; word++) {
+		uint64_t registers = 0;
+		for (unsigned int i = 0; i < 8; i++) {
+			registers |= static_cast<uint64_t>(snapshot.v[word * 8 + i]) << (8 * i);
+		}
+		slot.registers[word].store(registers, std::memory_order_relaxed);
+	}
+	slot.control.store(snapshot.Control(), std::memory_order_relaxed);
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; row++) {
+		slot.rows[row].store(snapshot.rows[row], std::memory_order_relaxed);
+	}
+	slot.frame.store(slot.frame.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	// even again: the update is complete
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "sharedstate.h"
+#include <string>
+
+// Publishes the display, registers and a frame counter of running machines into a POSIX shared
+// memory region (layout in sharedstate.h), one slot per instance. Publish is a handful of
+// relaxed atomic stores between two sequence bumps, with no system calls, so the emulation loop
+// can call it every frame. Readers in other processes use SharedStateReader.
+class SharedStateExporter
+{
+	public:
+		// creates the shared memory object name (replacing any left over) with a slot per instance
+		SharedStateExporter(char const* name, unsigned int instances);
+
+		// unmaps and removes the object, readers that still have it mapped keep their last view
+		~SharedStateExporter();
+
+		SharedStateExporter(SharedStateExporter const&) = delete;
+		SharedStateExporter& operator=(SharedStateExporter const&) = delete;
+
+		bool IsOpen() const { return slots != nullptr; }
+
+		// publishes a machine's state as the instance's next frame
+		void Publish(unsigned int instance, Chip8 const& chip8);
+
+		// publishes a snapshot as the instance's next frame, its frame field is ignored
+		void Publish(unsigned int instance, SharedSnapshot const& snapshot);
+
+	private:
+		std::string name;
+		void* region{};
+		size_t size{};
+		SharedSlot* slots{};
+		unsigned int instances{};
+};
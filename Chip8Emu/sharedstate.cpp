@@ -0,0 +1,129 @@
+// *********************************************************
+//
+//			   SHARED STATE REGION READER
+//
+// *********************************************************
+
+// header inclusion
+#include "sharedstate.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Function to pack I, PC, SP, the timers and the fault into one word
+uint64_t SharedSnapshot::Control() const
+{
+	return static_cast<uint64_t>(index) | static_cast<uint64_t>(pc) << 16 | static_cast<uint64_t>(sp) << 32 |
+		static_cast<uint64_t>(delay) << 40 | static_cast<uint64_t>(sound) << 48 | static_cast<uint64_t>(fault) << 56;
+}
+
+// Function to unpack the control word
+void SharedSnapshot::SetControl(uint64_t control)
+{
+	index = static_cast<uint16_t>(control);
+	pc = static_cast<uint16_t>(control >> 16);
+	sp = static_cast<uint8_t>(control >> 32);
+	delay = static_cast<uint8_t>(control >> 40);
+	sound = static_cast<uint8_t>(control >> 48);
+	fault = static_cast<uint8_t>(control >> 56);
+}
+
+#ifdef __linux__
+
+// Reader destructor declaration
+SharedStateReader::~SharedStateReader()
+{
+	if (region) {
+		munmap(const_cast<void*>(region), size);
+	}
+}
+
+// Function to map a shared state region and check its header
+bool SharedStateReader::Open(char const* name)
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+	bool sized = fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SharedSlot);
+	void* mapped = sized ? mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+
+	// the header takes the first slot's worth of space, so every slot stays on its own cache lines
+	SharedHeader const* header = static_cast<SharedHeader const*>(mapped);
+	size_t needed = sizeof(SharedSlot) * (static_cast<size_t>(header->instances) + 1);
+	if (header->magic != SHARED_MAGIC || header->version != SHARED_VERSION || header->slotSize != sizeof(SharedSlot) ||
+		needed > static_cast<size_t>(info.st_size)) {
+		munmap(mapped, info.st_size);
+		return false;
+	}
+
+	region = mapped;
+	size = info.st_size;
+	slots = static_cast<SharedSlot const*>(mapped) + 1;
+	instances = header->instances;
+	return true;
+}
+
+#else
+
+SharedStateReader::~SharedStateReader() {}
+bool SharedStateReader::Open(char const*) { return false; }
+
+#endif
+
+// Function to take a consistent snapshot of an instance
+bool SharedStateReader::Read(unsigned int instance, SharedSnapshot& snapshot) const
+{
+	if (instance >= instances) {
+		return false;
+	}
+
+	SharedSlot const& slot = slots[instance];
+
+	for (unsigned int attempt = 0; attempt < READ_ATTEMPTS; attempt++) {
+		uint32_t before = slot.sequence.load(std::memory_order_acquire);
+
+		if (!(before & 1)) {
+			snapshot.frame = slot.frame.load(std::memory_order_relaxed);
+			for (unsigned int word = 0; word < 2; word++) {
+				uint64_t registers = slot.registers[word].load(std::memory_order_relaxed);
+				for (unsigned int i = 0; i < 8; i++) {
+					snapshot.v[word * 8 + i] = static_cast<uint8_t>(registers >> (8 * i));
+				}
+			}
+			snapshot.SetControl(slot.control.load(std::memory_order_relaxed));
+			for (unsigned int row = 0; row < VIDEO_HEIGHT; row++) {
+				snapshot.rows[row] = slot.rows[row].load(std::memory_order_relaxed);
+			}
+
+			// the copy is good if no write started or finished while it was taken
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == before) {
+				return true;
+			}
+		}
+
+		++retries;
+	}
+
+	return false;
+}
+
+// Function to read an instance's frame counter on its own
+uint64_t SharedStateReader::Frame(unsigned int instance) const
+{
+	return instance < instances ? slots[instance].frame.load(std::memory_order_acquire) : 0;
+}
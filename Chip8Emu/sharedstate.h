@@ -0,0 +1,80 @@
+#pragma once
+#include "chip8.h"
+#include <atomic>
+
+// SHARED STATE REGION LAYOUT
+// A POSIX shared-memory object holding a SharedHeader and then one SharedSlot per instance. Each slot
+// is guarded by a seqlock: the writer makes sequence odd, stores the state and makes it even again,
+// and a reader keeps a copy only if it saw the same even sequence before and after copying. Every
+// field is a lock-free atomic, so readers in other processes need no locks and no system calls.
+// The region is written by SharedStateExporter (sharedexport.h) and read by SharedStateReader.
+
+const uint32_t SHARED_MAGIC = 0x4D533843;	// "C8SM"
+const uint32_t SHARED_VERSION = 1;
+
+struct SharedHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t instances;
+	uint32_t slotSize;		// bytes per SharedSlot, for readers built against another layout
+};
+
+// One instance's state, registers packed into words so every store is a single atomic
+struct alignas(64) SharedSlot {
+	std::atomic<uint32_t> sequence;			// odd while the writer is in the middle of an update
+	std::atomic<uint64_t> frame;			// frames published so far, 0 before the first
+	std::atomic<uint64_t> registers[2];		// V0-V7 and V8-VF, V0 in the low byte
+	std::atomic<uint64_t> control;			// I, PC, SP, DT, ST and the fault, see SharedSnapshot
+	std::atomic<uint64_t> rows[VIDEO_HEIGHT];	// display rows, bit 63 is the leftmost pixel
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared slots need lock-free 64-bit atomics");
+
+// A consistent copy of one slot
+struct SharedSnapshot {
+	uint64_t frame;
+	uint8_t v[REGISTER_COUNT];
+	uint16_t index;
+	uint16_t pc;
+	uint8_t sp;
+	uint8_t delay;
+	uint8_t sound;
+	uint8_t fault;
+	uint64_t rows[VIDEO_HEIGHT];
+
+	// packs and unpacks the control word: I in bits 0-15, PC 16-31, SP 32-39, DT 40-47, ST 48-55, fault 56-63
+	uint64_t Control() const;
+	void SetControl(uint64_t control);
+};
+
+// Maps a shared state region read-only and takes consistent snapshots of its instances.
+// It only needs this header and sharedstate.cpp, not the emulator core.
+class SharedStateReader
+{
+	public:
+		~SharedStateReader();
+
+		// maps the region called name, returns false if it doesn't exist or isn't a shared state region
+		bool Open(char const* name);
+
+		unsigned int Instances() const { return instances; }
+
+		// copies a consistent snapshot of an instance. Returns false if the writer kept updating it
+		// through every attempt, which only happens when reads are starved
+		bool Read(unsigned int instance, SharedSnapshot& snapshot) const;
+
+		// the instance's frame counter, without taking a snapshot, to poll for new frames cheaply
+		uint64_t Frame(unsigned int instance) const;
+
+		// snapshots that had to be retried because a write overlapped them
+		uint64_t Retries() const { return retries; }
+
+	private:
+		static const unsigned int READ_ATTEMPTS = 1000;
+
+		void const* region{};
+		size_t size{};
+		SharedSlot const* slots{};
+		unsigned int instances{};
+		mutable uint64_t retries{};
+};
@@ -0,0 +1,611 @@
+// *********************************************************
+//
+//			   FRAMEBUFFER STREAMING SERVER
+//
+// *********************************************************
+
+// header inclusion
+#include "stream.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// a viewer with this much unsent data gets no more deltas until it catches up
+const size_t STREAM_BACKLOG_LIMIT = 64 * 1024;
+
+// Function to append a little-endian 32-bit value
+static void PutLE32(vector<uint8_t>& out, uint32_t value)
+{
+	for (int i = 0; i < 4; ++i) {
+		out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+	}
+}
+
+// Function to append a packed row, leftmost pixel first
+static void PutRow(vector<uint8_t>& out, uint64_t row)
+{
+	for (int i = 7; i >= 0; --i) {
+		out.push_back(static_cast<uint8_t>(row >> (8 * i)));
+	}
+}
+
+// Function to read a packed row written by PutRow
+static uint64_t GetRow(uint8_t const* bytes)
+{
+	uint64_t row = 0;
+	for (int i = 0; i < 8; ++i) {
+		row = (row << 8) | bytes[i];
+	}
+	return row;
+}
+
+// Function to build a keyframe message
+static void PutKeyframe(vector<uint8_t>& out, CapturedFrame const& frame)
+{
+	out.push_back(STREAM_KEYFRAME);
+	PutLE32(out, frame.frame);
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		PutRow(out, frame.rows[row]);
+	}
+}
+
+#ifdef __linux__
+
+// Server constructor declaration
+FrameServer::FrameServer()
+{
+}
+
+// Server destructor declaration
+FrameServer::~FrameServer()
+{
+	if (running) {
+		running = false;
+
+		// wake the server thread so it sees running is false
+		uint64_t one = 1;
+		(void)!write(wakeFd, &one, sizeof(one));
+		server.join();
+	}
+
+	for (auto& viewer : viewers) {
+		close(viewer.first);
+	}
+
+	for (int fd : { listenFd, epollFd, wakeFd }) {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+}
+
+// Function to register a machine to publish
+unsigned int FrameServer::AddInstance()
+{
+	instances.push_back(std::make_unique<Instance>());
+	return static_cast<unsigned int>(instances.size() - 1);
+}
+
+// Function to listen on the loopback interface
+bool FrameServer::ListenTcp(uint16_t requestedPort)
+{
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return false;
+	}
+
+	int yes = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(requestedPort);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	socklen_t length = sizeof(address);
+	if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+		getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+		close(fd);
+		return false;
+	}
+
+	port = ntohs(address.sin_port);
+	return Start(fd);
+}
+
+// Function to listen on a Unix domain socket
+bool FrameServer::ListenUnix(char const* path)
+{
+	sockaddr_un address{};
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		return false;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return false;
+	}
+
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	unlink(path);
+
+	if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+		close(fd);
+		return false;
+	}
+
+	return Start(fd);
+}
+
+// Function to start the epoll thread on a bound socket
+bool FrameServer::Start(int socket)
+{
+	if (running || listen(socket, 64) < 0) {
+		close(socket);
+		return false;
+	}
+
+	listenFd = socket;
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (epollFd < 0 || wakeFd < 0) {
+		return false;
+	}
+
+	for (int fd : { listenFd, wakeFd }) {
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+	}
+
+	running = true;
+	server = std::thread(&FrameServer::ServerLoop, this);
+	return true;
+}
+
+// Function to hand the current display of an instance to the server thread
+void FrameServer::Publish(unsigned int instance, uint64_t const* display)
+{
+	if (instance >= instances.size()) {
+		return;
+	}
+
+	Instance& target = *instances[instance];
+	{
+		std::lock_guard<std::mutex> guard(target.lock);
+		memcpy(target.pending.rows, display, sizeof(target.pending.rows));
+		++target.pending.frame;
+		target.published = true;
+	}
+
+	if (running) {
+		uint64_t one = 1;
+		(void)!write(wakeFd, &one, sizeof(one));
+	}
+}
+
+// Function to copy the key state sent by viewers
+void FrameServer::ApplyKeys(unsigned int instance, uint8_t* keys)
+{
+	if (instance >= instances.size()) {
+		return;
+	}
+
+	for (unsigned int key = 0; key < KEY_COUNT; ++key) {
+		keys[key] = instances[instance]->keys[key].load(std::memory_order_relaxed);
+	}
+}
+
+// Function run by the server thread
+void FrameServer::ServerLoop()
+{
+	epoll_event events[64];
+
+	while (running) {
+		int count = epoll_wait(epollFd, events, 64, -1);
+
+		for (int i = 0; i < count; ++i) {
+			int fd = events[i].data.fd;
+
+			if (fd == listenFd) {
+				Accept();
+			}
+			else if (fd == wakeFd) {
+				uint64_t wakes;
+				(void)!read(wakeFd, &wakes, sizeof(wakes));
+
+				for (unsigned int instance = 0; instance < instances.size(); ++instance) {
+					Broadcast(instance);
+				}
+			}
+			else {
+				auto viewer = viewers.find(fd);
+				if (viewer == viewers.end()) {
+					continue;
+				}
+
+				if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+					Drop(fd);
+					continue;
+				}
+				if (events[i].events & EPOLLIN) {
+					Read(fd, viewer->second);
+				}
+				viewer = viewers.find(fd);
+				if (viewer != viewers.end() && (events[i].events & EPOLLOUT)) {
+					Flush(fd, viewer->second);
+				}
+			}
+		}
+	}
+}
+
+// Function to accept every pending connection
+void FrameServer::Accept()
+{
+	while (true) {
+		int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			return;
+		}
+
+		// frames are small and latency matters more than packet count
+		int yes = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+
+		viewers[fd] = Viewer();
+		++viewerCount;
+	}
+}
+
+// Function to read and handle the messages of a viewer
+void FrameServer::Read(int fd, Viewer& viewer)
+{
+	uint8_t buffer[512];
+
+	while (true) {
+		ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+		if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+			Drop(fd);
+			return;
+		}
+		if (received < 0) {
+			break;
+		}
+		viewer.in.insert(viewer.in.end(), buffer, buffer + received);
+	}
+
+	size_t pos = 0;
+	while (pos < viewer.in.size()) {
+		uint8_t type = viewer.in[pos];
+
+		if (type == STREAM_SUBSCRIBE) {
+			if (viewer.in.size() - pos < 3) {
+				break;
+			}
+
+			unsigned int instance = viewer.in[pos + 1] | (viewer.in[pos + 2] << 8);
+			pos += 3;
+
+			if (instance >= instances.size()) {
+				Drop(fd);
+				return;
+			}
+
+			// start the new viewer from the last broadcast frame
+			viewer.instance = static_cast<int>(instance);
+			viewer.needsKeyframe = false;
+			PutKeyframe(viewer.out, instances[instance]->sent);
+		}
+		else if (type == STREAM_KEY) {
+			if (viewer.in.size() - pos < 3) {
+				break;
+			}
+
+			uint8_t key = viewer.in[pos + 1] & 0xFu;
+			uint8_t down = viewer.in[pos + 2] ? 1 : 0;
+			pos += 3;
+
+			if (viewer.instance >= 0) {
+				instances[viewer.instance]->keys[key].store(down, std::memory_order_relaxed);
+			}
+		}
+		else {
+			// not speaking the protocol
+			Drop(fd);
+			return;
+		}
+	}
+
+	viewer.in.erase(viewer.in.begin(), viewer.in.begin() + pos);
+	Flush(fd, viewer);
+}
+
+// Function to send as much queued output as the socket takes
+void FrameServer::Flush(int fd, Viewer& viewer)
+{
+	while (viewer.outSent < viewer.out.size()) {
+		ssize_t sent = send(fd, viewer.out.data() + viewer.outSent, viewer.out.size() - viewer.outSent, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				Drop(fd);
+				return;
+			}
+			break;
+		}
+		viewer.outSent += sent;
+	}
+
+	if (viewer.outSent == viewer.out.size()) {
+		viewer.out.clear();
+		viewer.outSent = 0;
+	}
+
+	// only ask for EPOLLOUT while something is waiting to go out
+	bool writing = !viewer.out.empty();
+	if (writing != viewer.writing) {
+		epoll_event event{};
+		event.events = EPOLLIN | (writing ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+		event.data.fd = fd;
+		epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+		viewer.writing = writing;
+	}
+}
+
+// Function to disconnect a viewer
+void FrameServer::Drop(int fd)
+{
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	close(fd);
+
+	if (viewers.erase(fd)) {
+		--viewerCount;
+	}
+}
+
+// Function to send the latest published frame of an instance to its viewers
+void FrameServer::Broadcast(unsigned int instance)
+{
+	Instance& source = *instances[instance];
+	CapturedFrame frame;
+	{
+		std::lock_guard<std::mutex> guard(source.lock);
+		if (!source.published) {
+			return;
+		}
+		frame = source.pending;
+		source.published = false;
+	}
+
+	// the delta is built once and shared by every viewer that's in step
+	vector<uint8_t> delta;
+	delta.push_back(STREAM_DELTA);
+	PutLE32(delta, frame.frame);
+	PutLE32(delta, 0);
+
+	uint32_t changed = 0;
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		uint64_t difference = frame.rows[row] ^ source.sent.rows[row];
+		if (difference) {
+			changed |= 1u << row;
+			PutRow(delta, difference);
+		}
+	}
+	memcpy(&delta[5], &changed, sizeof(changed));
+
+	vector<uint8_t> keyframe;
+	PutKeyframe(keyframe, frame);
+
+	bool periodic = frame.frame % STREAM_KEYFRAME_INTERVAL == 0;
+	source.sent = frame;
+
+	vector<int> ready;
+	for (auto& entry : viewers) {
+		Viewer& viewer = entry.second;
+		if (viewer.instance != static_cast<int>(instance)) {
+			continue;
+		}
+
+		size_t backlog = viewer.out.size() - viewer.outSent;
+
+		// a viewer that can't keep up misses deltas and resyncs with a keyframe once drained
+		if (backlog > STREAM_BACKLOG_LIMIT) {
+			viewer.needsKeyframe = true;
+			continue;
+		}
+
+		if (periodic || viewer.needsKeyframe) {
+			if (backlog > 0 && viewer.needsKeyframe) {
+				continue;
+			}
+			viewer.out.insert(viewer.out.end(), keyframe.begin(), keyframe.end());
+			viewer.needsKeyframe = false;
+		}
+		else {
+			viewer.out.insert(viewer.out.end(), delta.begin(), delta.end());
+		}
+		ready.push_back(entry.first);
+	}
+
+	for (int fd : ready) {
+		auto viewer = viewers.find(fd);
+		if (viewer != viewers.end()) {
+			Flush(fd, viewer->second);
+		}
+	}
+}
+
+// Client destructor declaration
+FrameClient::~FrameClient()
+{
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+// Function to connect to a server over TCP
+bool FrameClient::ConnectTcp(char const* host, uint16_t port)
+{
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	if (inet_pton(AF_INET, host, &address.sin_addr) != 1) {
+		return false;
+	}
+
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+		return false;
+	}
+
+	int yes = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+	return true;
+}
+
+// Function to connect to a server over a Unix domain socket
+bool FrameClient::ConnectUnix(char const* path)
+{
+	sockaddr_un address{};
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		return false;
+	}
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	return fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+}
+
+// Function to send a whole message
+bool FrameClient::Send(uint8_t const* data, size_t size)
+{
+	while (size > 0) {
+		ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+		if (sent <= 0) {
+			return false;
+		}
+		data += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+// Function to read exactly size bytes
+bool FrameClient::ReadExactly(void* buffer, size_t size)
+{
+	uint8_t* bytes = static_cast<uint8_t*>(buffer);
+
+	while (size > 0) {
+		ssize_t received = recv(fd, bytes, size, 0);
+		if (received <= 0) {
+			return false;
+		}
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+// Function to subscribe to an instance
+bool FrameClient::Subscribe(uint16_t instance)
+{
+	uint8_t message[] = { STREAM_SUBSCRIBE, static_cast<uint8_t>(instance), static_cast<uint8_t>(instance >> 8) };
+	return Send(message, sizeof(message));
+}
+
+// Function to send a key event
+bool FrameClient::SendKey(uint8_t key, bool down)
+{
+	uint8_t message[] = { STREAM_KEY, key, static_cast<uint8_t>(down ? 1 : 0) };
+	return Send(message, sizeof(message));
+}
+
+// Function to apply the next frame message
+bool FrameClient::Receive(CapturedFrame& frame)
+{
+	uint8_t header[5];
+	if (!ReadExactly(header, sizeof(header))) {
+		return false;
+	}
+
+	frame.frame = header[1] | (header[2] << 8) | (header[3] << 16) | (static_cast<uint32_t>(header[4]) << 24);
+
+	if (header[0] == STREAM_KEYFRAME) {
+		uint8_t rows[VIDEO_HEIGHT * 8];
+		if (!ReadExactly(rows, sizeof(rows))) {
+			return false;
+		}
+		for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+			frame.rows[row] = GetRow(rows + row * 8);
+		}
+		return true;
+	}
+
+	if (header[0] == STREAM_DELTA) {
+		uint8_t mask[4];
+		if (!ReadExactly(mask, sizeof(mask))) {
+			return false;
+		}
+
+		uint32_t changed = mask[0] | (mask[1] << 8) | (mask[2] << 16) | (static_cast<uint32_t>(mask[3]) << 24);
+		for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+			if (changed & (1u << row)) {
+				uint8_t bytes[8];
+				if (!ReadExactly(bytes, sizeof(bytes))) {
+					return false;
+				}
+				frame.rows[row] ^= GetRow(bytes);
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+#else
+
+// Streaming needs epoll, so on other platforms the server never starts
+
+FrameServer::FrameServer() {}
+FrameServer::~FrameServer() {}
+
+unsigned int FrameServer::AddInstance()
+{
+	instances.push_back(std::make_unique<Instance>());
+	return static_cast<unsigned int>(instances.size() - 1);
+}
+
+bool FrameServer::ListenTcp(uint16_t) { return false; }
+bool FrameServer::ListenUnix(char const*) { return false; }
+void FrameServer::Publish(unsigned int, uint32_t const*) {}
+void FrameServer::ApplyKeys(unsigned int, uint8_t*) {}
+
+FrameClient::~FrameClient() {}
+bool FrameClient::ConnectTcp(char const*, uint16_t) { return false; }
+bool FrameClient::ConnectUnix(char const*) { return false; }
+bool FrameClient::Subscribe(uint16_t) { return false; }
+bool FrameClient::SendKey(uint8_t, bool) { return false; }
+bool FrameClient::Receive(CapturedFrame&) { return false; }
+
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+#include "capture.h"
+#include <map>
+#include <memory>
+#include <mutex>
+
+// STREAM PROTOCOL
+// Viewer -> server:
+//   'S' instance (u16)            subscribe to an instance, answered with a keyframe
+//   'k' key (u8) down (u8)        key event for the subscribed instance
+// Server -> viewer (integers little endian, rows as 8 bytes with the leftmost pixel in the top bit):
+//   'K' frame (u32) rows[32]                       the whole frame
+//   'D' frame (u32) changed (u32) rows[changed]    XOR with the previous frame for each changed row
+// Keyframes are also sent every STREAM_KEYFRAME_INTERVAL frames and whenever a viewer fell behind.
+
+const uint8_t STREAM_SUBSCRIBE = 'S';
+const uint8_t STREAM_KEY = 'k';
+const uint8_t STREAM_KEYFRAME = 'K';
+const uint8_t STREAM_DELTA = 'D';
+const unsigned int STREAM_KEYFRAME_INTERVAL = 120;
+
+// Publishes the displays of any number of emulated machines to any number of viewers over a TCP or
+// Unix socket, and collects their key presses. All socket I/O runs on one epoll thread; Publish
+// only copies the packed frame and wakes it. Linux only, elsewhere Listen fails.
+class FrameServer
+{
+	public:
+		FrameServer();
+		~FrameServer();
+
+		// registers a machine to publish, all instances must be added before listening
+		unsigned int AddInstance();
+
+		// starts serving on 127.0.0.1:port (0 picks a free port, see Port) or on a Unix socket
+		bool ListenTcp(uint16_t port);
+		bool ListenUnix(char const* path);
+		uint16_t Port() const { return port; }
+
+		// hands the current display of an instance to its viewers
+		void Publish(unsigned int instance, uint64_t const* display);
+
+		// copies the key state viewers sent for an instance into keys
+		void ApplyKeys(unsigned int instance, uint8_t* keys);
+
+		unsigned int ViewerCount() const { return viewerCount.load(); }
+
+	private:
+		struct Instance {
+			std::mutex lock;
+			CapturedFrame pending{};		// latest published frame, guarded by lock
+			bool published{};
+			CapturedFrame sent{};			// last frame broadcast, server thread only
+			std::atomic<uint8_t> keys[KEY_COUNT]{};
+		};
+
+		struct Viewer {
+			int instance{ -1 };
+			bool needsKeyframe{ true };
+			bool writing{};					// waiting for the socket to accept more
+			std::vector<uint8_t> in;
+			std::vector<uint8_t> out;
+			size_t outSent{};
+		};
+
+		bool Start(int socket);
+		void ServerLoop();
+		void Accept();
+		void Read(int fd, Viewer& viewer);
+		void Flush(int fd, Viewer& viewer);
+		void Drop(int fd);
+		void Broadcast(unsigned int instance);
+
+		std::vector<std::unique_ptr<Instance>> instances;
+		std::map<int, Viewer> viewers;
+		std::atomic<unsigned int> viewerCount{};
+
+		int listenFd{ -1 };
+		int epollFd{ -1 };
+		int wakeFd{ -1 };
+		uint16_t port{};
+		std::atomic<bool> running{};
+		std::thread server;
+};
+
+// Blocking viewer for a FrameServer, keeps its own copy of the frame up to date
+class FrameClient
+{
+	public:
+		~FrameClient();
+
+		bool ConnectTcp(char const* host, uint16_t port);
+		bool ConnectUnix(char const* path);
+
+		bool Subscribe(uint16_t instance);
+		bool SendKey(uint8_t key, bool down);
+
+		// waits for the next keyframe or delta and applies it to frame, false when the server went away
+		bool Receive(CapturedFrame& frame);
+
+	private:
+		bool ReadExactly(void* buffer, size_t size);
+		bool Send(uint8_t const* data, size_t size);
+
+		int fd{ -1 };
+};
@@ -0,0 +1,208 @@
+// *********************************************************
+//
+//			   ANSI TERMINAL PLATFORM BACKEND
+//
+// *********************************************************
+
+#include "terminalplatform.h"
+#include <cerrno>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace std;
+
+// glyph of each cell by its two pixels, bit 0 the top one and bit 1 the bottom one
+static char const* const HALF_BLOCKS[4] = { " ", "\xE2\x96\x80", "\xE2\x96\x84", "\xE2\x96\x88" };
+
+// keyboard layout of the hex keypad, the same keys as the SDL backend
+//   1 2 3 4        1 2 3 C
+//   q w e r   ->   4 5 6 D
+//   a s d f        7 8 9 E
+//   z x c v        A 0 B F
+static int KeypadKey(char c)
+{
+	switch (c)
+	{
+	case 'x': return 0x0;
+	case '1': return 0x1;
+	case '2': return 0x2;
+	case '3': return 0x3;
+	case 'q': return 0x4;
+	case 'w': return 0x5;
+	case 'e': return 0x6;
+	case 'a': return 0x7;
+	case 's': return 0x8;
+	case 'd': return 0x9;
+	case 'z': return 0xA;
+	case 'c': return 0xB;
+	case '4': return 0xC;
+	case 'r': return 0xD;
+	case 'f': return 0xE;
+	case 'v': return 0xF;
+	default: return -1;
+	}
+}
+
+TerminalPlatform::TerminalPlatform(int textureWidth, int textureHeight)
+	: width(textureWidth), height(textureHeight), rows((textureHeight + 1) / 2), cells(static_cast<size_t>(width) * rows, 0)
+{
+	// no echo, no line buffering, and reads that return at once; Ctrl+C still raises SIGINT
+	if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0)
+	{
+		termios raw = saved;
+		raw.c_lflag &= ~(ICANON | ECHO);
+		raw.c_cc[VMIN] = 0;
+		raw.c_cc[VTIME] = 0;
+		rawMode = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+	}
+
+	// alternate screen, hidden cursor, cleared, which is what the blank cells say is on screen
+	Write("\x1b[?1049h\x1b[?25l\x1b[2J");
+}
+
+TerminalPlatform::~TerminalPlatform()
+{
+	Write("\x1b[0m\x1b[?25h\x1b[?1049l");
+
+	if (rawMode)
+	{
+		tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+	}
+}
+
+void TerminalPlatform::Write(string const& text)
+{
+	size_t written = 0;
+
+	while (written < text.size())
+	{
+		ssize_t result = write(STDOUT_FILENO, text.data() + written, text.size() - written);
+		if (result < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (result <= 0)
+		{
+			break;
+		}
+		written += static_cast<size_t>(result);
+	}
+
+	bytesWritten += written;
+}
+
+void TerminalPlatform::Update(void const* buffer, int pitch)
+{
+	uint8_t const* pixels = static_cast<uint8_t const*>(buffer);
+	char move[32];
+	frame.clear();
+
+	for (int row = 0; row < rows; row++)
+	{
+		uint32_t const* top = reinterpret_cast<uint32_t const*>(pixels + static_cast<size_t>(2 * row) * pitch);
+		uint32_t const* bottom = 2 * row + 1 < height
+			? reinterpret_cast<uint32_t const*>(pixels + static_cast<size_t>(2 * row + 1) * pitch)
+			: nullptr;
+
+		for (int col = 0; col < width; col++)
+		{
+			uint8_t glyph = (top[col] ? 1 : 0) | (bottom && bottom[col] ? 2 : 0);
+			uint8_t& cell = cells[static_cast<size_t>(row) * width + col];
+			if (cell == glyph)
+			{
+				continue;
+			}
+			cell = glyph;
+
+			// a short hop right along the row is cheaper than addressing the cell
+			if (row == cursorRow && col > cursorCol && cursorCol >= 0)
+			{
+				snprintf(move, sizeof(move), col - cursorCol == 1 ? "\x1b[C" : "\x1b[%dC", col - cursorCol);
+				frame += move;
+			}
+			else if (row != cursorRow || col != cursorCol)
+			{
+				snprintf(move, sizeof(move), "\x1b[%d;%dH", row + 1, col + 1);
+				frame += move;
+			}
+
+			frame += HALF_BLOCKS[glyph];
+			cursorRow = row;
+			cursorCol = col + 1;
+
+			// past the last column terminals differ on where the cursor is
+			if (cursorCol == width)
+			{
+				cursorRow = -1;
+			}
+		}
+	}
+
+	if (!frame.empty())
+	{
+		Write(frame);
+	}
+}
+
+bool TerminalPlatform::ProcessInput(uint8_t* keys)
+{
+	bool quit = Interrupted();
+	auto now = std::chrono::steady_clock::now();
+	char input[64];
+	ssize_t length;
+
+	while ((length = read(STDIN_FILENO, input, sizeof(input))) > 0)
+	{
+		for (ssize_t i = 0; i < length; i++)
+		{
+			char c = input[i];
+
+			// a lone Escape quits, escape sequences (arrow keys and the like) are skipped
+			if (c == '\x1b')
+			{
+				if (i + 1 < length && (input[i + 1] == '[' || input[i + 1] == 'O'))
+				{
+					i += 2;
+					while (i < length && !(input[i] >= 0x40 && input[i] <= 0x7E))
+					{
+						i++;
+					}
+				}
+				else
+				{
+					quit = true;
+				}
+				continue;
+			}
+
+			if (c == '\t')
+			{
+				fastForward = !fastForward;
+				continue;
+			}
+
+			int key = KeypadKey(c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c);
+			if (key >= 0)
+			{
+				heldUntil[key] = now + TERMINAL_KEY_HOLD;
+			}
+		}
+	}
+
+	for (int key = 0; key < 16; key++)
+	{
+		keys[key] = heldUntil[key] > now ? 1 : 0;
+	}
+
+	return quit;
+}
+
+void TerminalPlatform::SetSound(bool on)
+{
+	// the terminal bell is as close as a terminal gets to a buzzer, rung as the sound starts
+	if (on && !sounding)
+	{
+		Write("\a");
+	}
+	sounding = on;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "platform.h"
+#include <chrono>
+#include <string>
+#include <vector>
+#include <termios.h>
+
+// Draws the display on an ANSI terminal, two pixel rows per text row with Unicode half-blocks, and
+// reads keys from stdin in raw mode. Only cells that changed since the last frame are written, with
+// the shortest cursor move to reach each one, so a frame that changes nothing writes nothing.
+// Terminals don't report key releases, so a key counts as held until it hasn't been seen for
+// TERMINAL_KEY_HOLD; the keyboard's auto-repeat keeps a held key down. POSIX only.
+class TerminalPlatform : public Platform
+{
+	public:
+		// switches the terminal to raw mode and the alternate screen
+		TerminalPlatform(int textureWidth, int textureHeight);
+
+		// puts the terminal back the way it was
+		~TerminalPlatform() override;
+
+		void Update(void const* buffer, int pitch) override;
+		bool ProcessInput(uint8_t* keys) override;
+		void SetSound(bool on) override;
+
+		// bytes written to the terminal so far, escape sequences included
+		uint64_t BytesWritten() const { return bytesWritten; }
+
+	private:
+		static constexpr std::chrono::milliseconds TERMINAL_KEY_HOLD{ 300 };
+
+		// writes out, all of it
+		void Write(std::string const& text);
+
+		int width;
+		int height;
+		int rows;							// text rows, two pixel rows each
+		std::vector<uint8_t> cells;			// glyph on screen per cell, an index into HALF_BLOCKS
+		int cursorRow{ -1 };				// where the terminal's cursor is, -1 when unknown
+		int cursorCol{ -1 };
+		std::string frame;					// output of the frame being drawn, reused
+
+		std::chrono::steady_clock::time_point heldUntil[16]{};
+		bool sounding{};
+		uint64_t bytesWritten{};
+
+		bool rawMode{};
+		termios saved{};					// the terminal settings to restore
+};
@@ -0,0 +1,301 @@
+// *********************************************************
+//
+//			   BINARY EXECUTION TRACE RECORDER
+//
+// *********************************************************
+
+// header inclusion
+#include "trace.h"
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+// Function to append a variable-length unsigned integer, 7 bits per byte
+static void PutVarint(vector<uint8_t>& out, uint32_t value)
+{
+	while (value >= 0x80u) {
+		out.push_back(static_cast<uint8_t>(value | 0x80u));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+// Function to read a variable-length unsigned integer, returns false at the end of the stream
+static bool GetVarint(istream& in, uint32_t& value)
+{
+	value = 0;
+
+	for (unsigned int shift = 0; shift < 35; shift += 7) {
+		int byte = in.get();
+		if (byte == EOF) {
+			return false;
+		}
+
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Function to append a 16-bit value, low byte first
+static void PutWord(vector<uint8_t>& out, uint16_t value)
+{
+	out.push_back(static_cast<uint8_t>(value));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+// Recorder constructor declaration
+TraceRecorder::TraceRecorder(char const* filename)
+	: file(filename, ios::binary), ring(RING_SIZE)
+{
+	if (!file.is_open()) {
+		running = false;
+		return;
+	}
+
+	file.write("C8T\x01", 4);
+	bytes = 4;
+
+	writer = std::thread(&TraceRecorder::WriterLoop, this);
+}
+
+// Recorder destructor declaration
+TraceRecorder::~TraceRecorder()
+{
+	Close();
+}
+
+// Function to stop the writer once it has written everything queued
+void TraceRecorder::Close()
+{
+	running = false;
+
+	if (writer.joinable()) {
+		writer.join();
+	}
+
+	if (file.is_open()) {
+		file.close();
+	}
+}
+
+// Function to wait until the writer has freed the slot Record wants to fill
+void TraceRecorder::WaitForRoom(uint32_t slot)
+{
+	tailSeen = tail.load(std::memory_order_acquire);
+
+	// a recorder whose file didn't open has no writer, its records are thrown away
+	if (!writer.joinable()) {
+		tail.store(slot, std::memory_order_relaxed);
+		tailSeen = slot;
+		return;
+	}
+
+	while (slot - tailSeen == RING_SIZE) {
+		++stalls;
+		std::this_thread::yield();
+		tailSeen = tail.load(std::memory_order_acquire);
+	}
+}
+
+// Function run by the writer thread, encodes queued records until the recorder is closed
+void TraceRecorder::WriterLoop()
+{
+	vector<uint8_t> payload;
+	vector<uint8_t> header;
+	auto predictor = std::make_unique<TracePredictor>();
+	uint32_t records = 0;
+	uint32_t run = 0;
+
+	// Function to write out a pending run of predicted records
+	auto endRun = [&]() {
+		if (run > 0) {
+			payload.push_back(TRACE_RUN);
+			PutVarint(payload, run);
+			run = 0;
+		}
+	};
+
+	// Function to write out the block encoded so far and start a new one
+	auto flush = [&]() {
+		endRun();
+		if (records == 0) {
+			return;
+		}
+
+		header.clear();
+		PutVarint(header, records);
+		PutVarint(header, static_cast<uint32_t>(payload.size()));
+		file.write(reinterpret_cast<char const*>(header.data()), header.size());
+		file.write(reinterpret_cast<char const*>(payload.data()), payload.size());
+
+		written += records;
+		bytes += header.size() + payload.size();
+
+		payload.clear();
+		*predictor = TracePredictor{};
+		records = 0;
+	};
+
+	while (true) {
+		uint32_t slot = tail.load(std::memory_order_relaxed);
+		uint32_t end = head.load(std::memory_order_acquire);
+
+		// nothing queued: finish if the recorder is closing, otherwise wait for more
+		if (slot == end) {
+			if (!running) {
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			continue;
+		}
+
+		for (; slot != end; ++slot) {
+			TraceRecord const& record = ring[slot & (RING_SIZE - 1)];
+			TraceRecord const& previous = predictor->previous;
+
+			uint8_t flags = 0;
+			flags |= record.pc != predictor->NextPc() ? TRACE_PC : 0;
+			flags |= record.opcode != predictor->OpcodeAt(record.pc) ? TRACE_OPCODE : 0;
+			flags |= record.reg != TRACE_NO_REGISTER ? TRACE_REGISTER : 0;
+			flags |= record.index != previous.index ? TRACE_INDEX : 0;
+			flags |= record.vf != previous.vf ? TRACE_VF : 0;
+
+			if (flags == 0) {
+				++run;
+			}
+			else {
+				endRun();
+				payload.push_back(flags);
+				if (flags & TRACE_PC) {
+					PutWord(payload, record.pc);
+				}
+				if (flags & TRACE_OPCODE) {
+					PutWord(payload, record.opcode);
+				}
+				if (flags & TRACE_REGISTER) {
+					payload.push_back(record.reg);
+					payload.push_back(record.value);
+				}
+				if (flags & TRACE_INDEX) {
+					PutWord(payload, record.index);
+				}
+				if (flags & TRACE_VF) {
+					payload.push_back(record.vf);
+				}
+			}
+
+			predictor->Update(record);
+
+			if (++records == TRACE_BLOCK_RECORDS) {
+				flush();
+			}
+		}
+
+		// the slots are only handed back once everything read from them is encoded
+		tail.store(slot, std::memory_order_release);
+	}
+
+	flush();
+	file.flush();
+}
+
+// Function to open a trace file and check its header
+bool TraceReader::Open(char const* filename)
+{
+	file.open(filename, ios::binary);
+
+	char header[4];
+	if (!file.read(header, sizeof(header))) {
+		return false;
+	}
+
+	return memcmp(header, "C8T\x01", 4) == 0;
+}
+
+// Function to load the next block and reset the decoding state
+bool TraceReader::ReadBlock()
+{
+	uint32_t records, size;
+	if (!GetVarint(file, records) || !GetVarint(file, size) || records == 0 || records > TRACE_BLOCK_RECORDS) {
+		return false;
+	}
+
+	block.resize(size);
+	if (!file.read(reinterpret_cast<char*>(block.data()), size)) {
+		return false;
+	}
+
+	remaining = records;
+	run = 0;
+	position = 0;
+	predictor = TracePredictor{};
+	return true;
+}
+
+// Function to decode the next traced instruction
+bool TraceReader::Next(TraceRecord& record)
+{
+	if (remaining == 0 && !ReadBlock()) {
+		return false;
+	}
+
+	// Function to read a byte of the block, reading past the end fails below
+	auto byte = [this]() -> uint8_t {
+		return position < block.size() ? block[position++] : (++position, 0);
+	};
+	auto word = [&byte]() -> uint16_t {
+		uint16_t low = byte();
+		return static_cast<uint16_t>(low | (byte() << 8));
+	};
+
+	uint8_t flags = 0;
+	if (run == 0) {
+		flags = byte();
+
+		if (flags == TRACE_RUN) {
+			for (unsigned int shift = 0; shift < 35; shift += 7) {
+				uint8_t next = byte();
+				run |= static_cast<uint32_t>(next & 0x7F) << shift;
+				if (!(next & 0x80)) {
+					break;
+				}
+			}
+			if (run == 0 || run > remaining) {
+				return false;
+			}
+			flags = 0;
+		}
+	}
+
+	if (run > 0) {
+		--run;
+	}
+
+	TraceRecord const& previous = predictor.previous;
+	record.pc = flags & TRACE_PC ? word() : predictor.NextPc();
+	record.opcode = flags & TRACE_OPCODE ? word() : predictor.OpcodeAt(record.pc);
+
+	record.reg = TRACE_NO_REGISTER;
+	record.value = 0;
+	if (flags & TRACE_REGISTER) {
+		record.reg = byte();
+		record.value = byte();
+	}
+
+	record.index = flags & TRACE_INDEX ? word() : previous.index;
+	record.vf = flags & TRACE_VF ? byte() : previous.vf;
+
+	if (position > block.size()) {
+		return false;
+	}
+
+	predictor.Update(record);
+	--remaining;
+	return true;
+}
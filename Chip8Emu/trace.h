@@ -0,0 +1,146 @@
+#pragma once
+#include "chip8.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// TRACE FILE FORMAT
+// Header: "C8T" 0x01
+// Then blocks of up to TRACE_BLOCK_RECORDS instructions, each decodable on its own:
+//   record count (varint), payload size in bytes (varint), payload
+// Every record in a payload is a flags byte followed by the fields it flags, little endian:
+//   TRACE_PC       pc (u16), when it isn't the pc that last followed the previous record's pc
+//                  in the block (or that pc + 2 the first time)
+//   TRACE_OPCODE   opcode (u16), when it isn't the opcode last traced at this pc in the block
+//   TRACE_REGISTER register (u8) and its new value (u8)
+//   TRACE_INDEX    I (u16), when it changed
+//   TRACE_VF       VF (u8), when it changed
+//   TRACE_RUN      alone, followed by a count (varint) of records that flag nothing
+// Every block starts predicting from an all-zero record, so loops cost a few bytes per pass
+// and a spinning idle loop next to nothing.
+
+const unsigned int TRACE_BLOCK_RECORDS = 4096;
+const uint8_t TRACE_PC = 0x01;
+const uint8_t TRACE_OPCODE = 0x02;
+const uint8_t TRACE_REGISTER = 0x04;
+const uint8_t TRACE_INDEX = 0x08;
+const uint8_t TRACE_VF = 0x10;
+const uint8_t TRACE_RUN = 0x80;
+
+// register field of a record whose instruction changed no register besides VF
+const uint8_t TRACE_NO_REGISTER = 0xFF;
+
+// One executed instruction and what it left behind
+struct TraceRecord {
+	uint16_t pc;		// address the instruction was fetched from
+	uint16_t opcode;
+	uint16_t index;		// I after the instruction
+	uint8_t reg;		// lowest of V0-VE the instruction changed, or TRACE_NO_REGISTER
+	uint8_t value;		// its new value
+	uint8_t vf;			// VF after the instruction
+};
+
+// What the encoder and the decoder expect the next record to be, from the records so far in a block
+struct TracePredictor {
+	TraceRecord previous{};
+	uint16_t opcodes[MEMORY_SIZE]{};	// last opcode traced at each pc
+	uint16_t successors[MEMORY_SIZE]{};	// pc traced right after each pc, 0 until there is one
+
+	uint16_t NextPc() const
+	{
+		uint16_t next = successors[previous.pc & (MEMORY_SIZE - 1)];
+		return next ? next : static_cast<uint16_t>(previous.pc + 2);
+	}
+
+	uint16_t OpcodeAt(uint16_t pc) const { return opcodes[pc & (MEMORY_SIZE - 1)]; }
+
+	void Update(TraceRecord const& record)
+	{
+		opcodes[record.pc & (MEMORY_SIZE - 1)] = record.opcode;
+		successors[previous.pc & (MEMORY_SIZE - 1)] = record.pc;
+		previous = record;
+	}
+};
+
+// Records every instruction a machine executes to a trace file from a background thread.
+// Record is a store into a single-producer ring; unlike FrameRecorder, a trace is useless with
+// holes in it, so when the writer falls behind Record waits for room instead of dropping.
+class TraceRecorder
+{
+	public:
+		// opens filename and starts the writer thread
+		explicit TraceRecorder(char const* filename);
+
+		// writes out everything queued and closes the file
+		~TraceRecorder();
+
+		TraceRecorder(TraceRecorder const&) = delete;
+		TraceRecorder& operator=(TraceRecorder const&) = delete;
+
+		// same as the destructor, afterwards Recorded and Bytes are final
+		void Close();
+
+		bool IsOpen() const { return file.is_open(); }
+
+		// queues an executed instruction, called by the machine the recorder is attached to
+		void Record(TraceRecord const& record)
+		{
+			uint32_t slot = head.load(std::memory_order_relaxed);
+
+			// the tail is only re-read once the ring looks full
+			if (slot - tailSeen == RING_SIZE) {
+				WaitForRoom(slot);
+			}
+
+			ring[slot & (RING_SIZE - 1)] = record;
+			head.store(slot + 1, std::memory_order_release);
+		}
+
+		uint64_t Recorded() const { return written.load(); }
+		uint64_t Bytes() const { return bytes.load(); }
+
+		// times Record had to wait for the writer
+		uint64_t Stalls() const { return stalls; }
+
+	private:
+		static const uint32_t RING_SIZE = 1u << 16;
+
+		void WaitForRoom(uint32_t slot);
+		void WriterLoop();
+
+		ofstream file;
+		std::thread writer;
+		std::atomic<bool> running{ true };
+
+		std::vector<TraceRecord> ring;
+		std::atomic<uint32_t> head{};	// next slot Record fills
+		std::atomic<uint32_t> tail{};	// next slot the writer encodes
+		uint32_t tailSeen{};			// last tail Record read, producer only
+		uint64_t stalls{};
+
+		std::atomic<uint64_t> written{};
+		std::atomic<uint64_t> bytes{};
+};
+
+// Reads the instructions of a trace file back, for offline comparison
+class TraceReader
+{
+	public:
+		// opens filename and reads the header, returns false if it isn't a trace file
+		bool Open(char const* filename);
+
+		// decodes the next instruction into record, returns false at the end of the file
+		bool Next(TraceRecord& record);
+
+	private:
+		// reads and checks the next block, returns false at the end of the file
+		bool ReadBlock();
+
+		ifstream file;
+		vector<uint8_t> block;
+		size_t position{};
+		uint32_t remaining{};		// records left in the block
+		uint32_t run{};				// records left in the current TRACE_RUN
+
+		TracePredictor predictor;
+};
@@ -0,0 +1,295 @@
+// *********************************************************
+//
+//				  HEADLESS BENCHMARK RUNNER
+//
+// *********************************************************
+
+// Runs a ROM headless through each execution path of the core and reports how many guest
+// instructions per second each one reaches, checking that they all end on the same frame.
+// Where Linux perf counters are available it also reports host IPC, branch mispredicts and cache
+// and TLB misses per guest instruction for each path, to show why one is faster than another.
+// Then it times starting the ROM cold, loading it from its file, and warm, copying a machine that
+// already has it loaded.
+
+// Libraries
+#include "tools.h"
+#include "chip8.h"
+#include "perfcounters.h"
+#include "pool.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// times each way of starting a ROM is repeated, and the frames run after starting it
+const unsigned int STARTUP_RUNS = 200;
+const unsigned int STARTUP_FRAMES = 60;
+
+// What one execution path measured
+struct EngineResult {
+	char const* name;
+	double rate;
+	unsigned long executed;		// instructions actually run, fewer than asked if the machine faulted
+	PerfSample counters;
+};
+
+// Function to time one execution path, with the host counters running around it
+template <typename Run>
+static EngineResult TimeRun(char const* name, Chip8& chip8, unsigned long cycles, PerfCounters& counters, Run run)
+{
+	counters.Start();
+	auto start = std::chrono::high_resolution_clock::now();
+	unsigned long executed = run(chip8, cycles);
+	auto end = std::chrono::high_resolution_clock::now();
+	PerfSample sample = counters.Stop();
+
+	double seconds = std::chrono::duration<double>(end - start).count();
+	double rate = cycles / seconds;
+
+	printf("  %-22s %10.3f ms  %10.2f Minstr/s\n", name, seconds * 1000.0, rate / 1e6);
+	return { name, rate, executed, sample };
+}
+
+// Function to print a counter column, "-" when it wasn't counted
+static void PrintCounter(double value, char const* format)
+{
+	if (value < 0.0) {
+		printf("%10s", "-");
+	}
+	else {
+		printf(format, value);
+	}
+}
+
+// Function to report the host counters of each path, per guest instruction
+static void ReportCounters(PerfCounters const& counters, EngineResult const* results, unsigned int count, unsigned long cycles)
+{
+	printf("Host counters per guest instruction\n");
+	printf("  %-22s %10s%10s%10s%10s%10s%10s%10s%10s\n", "", "CPU ns", "host IPC", "cycles", "instrs", "br-miss", "L1D-miss", "LLC-miss", "iTLB-miss");
+
+	for (unsigned int i = 0; i < count; ++i) {
+		PerfSample const& sample = results[i].counters;
+		printf("  %-22s ", results[i].name);
+		PrintCounter(sample.Per(PERF_TASK_CLOCK, cycles), "%10.2f");
+		PrintCounter(sample.Ratio(PERF_INSTRUCTIONS, PERF_CYCLES), "%10.2f");
+		PrintCounter(sample.Per(PERF_CYCLES, cycles), "%10.2f");
+		PrintCounter(sample.Per(PERF_INSTRUCTIONS, cycles), "%10.2f");
+		PrintCounter(sample.Per(PERF_BRANCH_MISSES, cycles), "%10.4f");
+		PrintCounter(sample.Per(PERF_L1D_MISSES, cycles), "%10.4f");
+		PrintCounter(sample.Per(PERF_LLC_MISSES, cycles), "%10.5f");
+		PrintCounter(sample.Per(PERF_ITLB_MISSES, cycles), "%10.5f");
+		printf("\n");
+	}
+
+	if (!counters.Problem().empty()) {
+		printf("  (%s)\n", counters.Problem().c_str());
+	}
+}
+
+// How one way of starting a ROM went, in microseconds per start
+struct StartupResult {
+	double loadUs;
+	double framesUs;
+	uint64_t hash;
+};
+
+// Function to time starting a ROM and running its first frames, STARTUP_RUNS times over
+template <typename Start>
+static StartupResult TimeStartup(char const* name, Start start)
+{
+	std::chrono::duration<double, std::micro> loading{}, running{};
+	uint64_t hash = 0;
+
+	for (unsigned int run = 0; run < STARTUP_RUNS; ++run) {
+		std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+
+		auto begin = std::chrono::high_resolution_clock::now();
+		start(*chip8);
+		auto started = std::chrono::high_resolution_clock::now();
+		for (unsigned int frame = 0; frame < STARTUP_FRAMES; ++frame) {
+			chip8->RunUntilFrame();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		loading += started - begin;
+		running += end - started;
+		hash = chip8->StateHash();
+	}
+
+	StartupResult result = { loading.count() / STARTUP_RUNS, running.count() / STARTUP_RUNS, hash };
+	printf("  %-22s %10.2f us %10.2f us %10.2f us\n", name, result.loadUs, result.framesUs, result.loadUs + result.framesUs);
+	return result;
+}
+
+// Function to compare starting a ROM from its file with starting it from a loaded copy
+static bool ReportStartup(char const* romFilename)
+{
+	// what a warm start begins from: the ROM already read, checked and placed in memory
+	Chip8 loaded;
+	loaded.SeedRandom(0);
+	loaded.LoadROM(romFilename);
+
+	printf("Startup, mean of %u starts\n", STARTUP_RUNS);
+	printf("  %-22s %13s %13s %13s\n", "", "start", "+ 60 frames", "total");
+
+	StartupResult cold = TimeStartup("cold (LoadROM)", [romFilename](Chip8& chip8) {
+		chip8.SeedRandom(0);
+		chip8.LoadROM(romFilename);
+	});
+	StartupResult warm = TimeStartup("warm (copy)", [&loaded](Chip8& chip8) {
+		chip8 = loaded;
+	});
+
+	if (warm.hash != cold.hash) {
+		std::cerr << "MISMATCH: a warm start ended in a different state\n";
+		return false;
+	}
+
+	return true;
+}
+
+// Function to benchmark the execution paths of the core on a ROM
+int BenchROM(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: bench <Cycles> <ROM> [Batch]\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned long cycles = std::stoul(argv[0]);
+	char const* romFilename = argv[1];
+	unsigned int batch = argc > 2 ? std::stoul(argv[2]) : 1000;
+
+	// one instruction per call, as the SDL host loop does
+	Chip8 reference;
+	reference.SetFusion(false);
+	reference.SeedRandom(0);
+	reference.LoadROM(romFilename);
+
+	// batched through the decode table alone
+	Chip8 decoded;
+	decoded.SetFusion(false);
+	decoded.SeedRandom(0);
+	decoded.LoadROM(romFilename);
+
+	// batched, with superinstructions and idle-loop skipping
+	Chip8 fast;
+	fast.SeedRandom(0);
+	fast.LoadROM(romFilename);
+
+	PerfCounters counters;
+
+	cout << "Running " << cycles << " instructions of " << romFilename << "\n";
+
+	// Function to run a machine in batches until it has executed count instructions or faulted
+	auto batched = [batch](Chip8& chip8, unsigned long count) {
+		unsigned long executed = 0;
+		while (executed < count) {
+			unsigned long left = count - executed;
+			unsigned int n = left < batch ? static_cast<unsigned int>(left) : batch;
+			Chip8Run run = chip8.RunCycles(n);
+			executed += run.executed;
+
+			// a faulted machine makes no more progress
+			if (run.stop == STOP_FAULT) {
+				break;
+			}
+		}
+		return executed;
+	};
+
+	EngineResult results[3];
+
+	results[0] = TimeRun("Cycle", reference, cycles, counters, [](Chip8& chip8, unsigned long count) {
+		for (unsigned long i = 0; i < count; i++) {
+			if (chip8.GetFault() != FAULT_NONE) {
+				return i;
+			}
+			chip8.Cycle();
+		}
+		return count;
+	});
+	results[1] = TimeRun("RunCycles (decoded)", decoded, cycles, counters, batched);
+	results[2] = TimeRun("RunCycles (fused)", fast, cycles, counters, batched);
+
+	double referenceRate = results[0].rate;
+	double fastRate = results[2].rate;
+
+	ReportCounters(counters, results, 3, cycles);
+
+	printf("  speedup %.2fx\n", fastRate / referenceRate);
+
+	// neither batched path may change the machine: registers, timers, memory, the stack, the random
+	// state and the display all go into StateHash, and a fault must stop every path at the same point
+	bool same = decoded.StateHash() == reference.StateHash() && fast.StateHash() == reference.StateHash() &&
+		results[1].executed == results[0].executed && results[2].executed == results[0].executed;
+
+	if (!same) {
+		std::cerr << "MISMATCH: a batched run ended in a different state\n";
+		return EXIT_FAILURE;
+	}
+
+	return ReportStartup(romFilename) ? 0 : EXIT_FAILURE;
+}
+
+// Function to time how long an allocation pattern takes per instance, in nanoseconds
+template <typename Allocate>
+static double TimePerInstance(char const* name, unsigned int count, Allocate allocate)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	allocate(count);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count() / count;
+	printf("  %-22s %10.0f ns per instance\n", name, nanoseconds);
+	return nanoseconds;
+}
+
+// Function to report the size of an instance and how fast many of them can be created
+int BenchInstances(int argc, char* argv[])
+{
+	if (argc < 1)
+	{
+		std::cerr << "Usage: instances <Count>\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned int count = std::stoul(argv[0]);
+
+	printf("Chip8 is %zu bytes, %zu bytes per pooled instance\n", sizeof(Chip8), Chip8Pool::SlotSize());
+	printf("Creating %u instances\n", count);
+
+	vector<std::unique_ptr<Chip8>> heap;
+	heap.reserve(count);
+	TimePerInstance("new", count, [&heap](unsigned int n) {
+		for (unsigned int i = 0; i < n; i++) {
+			heap.push_back(std::make_unique<Chip8>());
+		}
+	});
+	heap.clear();
+
+	Chip8Pool pool;
+	vector<Chip8*> pooled(count);
+	TimePerInstance("pool, first use", count, [&pool, &pooled](unsigned int n) {
+		for (unsigned int i = 0; i < n; i++) {
+			pooled[i] = pool.Acquire();
+		}
+	});
+
+	// the common case when sessions come and go: the slots are already mapped and cached
+	for (Chip8* chip8 : pooled) {
+		pool.Release(chip8);
+	}
+	TimePerInstance("pool, recycled", count, [&pool, &pooled](unsigned int n) {
+		for (unsigned int i = 0; i < n; i++) {
+			pooled[i] = pool.Acquire();
+		}
+	});
+
+	printf("  pool holds %zu instances in %.1f MB\n", pool.Live(), pool.Capacity() * Chip8Pool::SlotSize() / 1048576.0);
+	return 0;
+}
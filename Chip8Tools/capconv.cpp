@@ -0,0 +1,182 @@
+// *********************************************************
+//
+//			   CAPTURE FILE CONVERTER
+//
+// *********************************************************
+
+// Converts a capture written by FrameRecorder into a Y4M video or a numbered PNG sequence.
+// Dropped frames are filled in by repeating the previous one, so playback keeps its timing.
+
+// Libraries
+#include "tools.h"
+#include "capture.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Function to expand a captured frame into 8-bit grey pixels, scaled up by scale
+static vector<uint8_t> ExpandFrame(CapturedFrame const& frame, unsigned int scale)
+{
+	unsigned int width = VIDEO_WIDTH * scale;
+	vector<uint8_t> pixels(width * VIDEO_HEIGHT * scale);
+
+	for (unsigned int y = 0; y < VIDEO_HEIGHT * scale; ++y) {
+		uint64_t row = frame.rows[y / scale];
+		for (unsigned int x = 0; x < width; ++x) {
+			pixels[y * width + x] = (row >> (63 - x / scale)) & 1u ? 0xFF : 0x00;
+		}
+	}
+
+	return pixels;
+}
+
+// Function to compute the CRC-32 used by PNG chunks
+static uint32_t Crc32(uint8_t const* data, size_t size, uint32_t crc = 0)
+{
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i) {
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+	}
+	return ~crc;
+}
+
+// Function to append a big-endian 32-bit value
+static void PutBE32(vector<uint8_t>& out, uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+// Function to append a PNG chunk with its length and CRC
+static void PutChunk(vector<uint8_t>& png, char const* type, vector<uint8_t> const& data)
+{
+	PutBE32(png, static_cast<uint32_t>(data.size()));
+	size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+	PutBE32(png, Crc32(png.data() + start, png.size() - start));
+}
+
+// Function to write an 8-bit greyscale PNG, stored without compression to keep the tool dependency-free
+static bool WritePNG(string const& filename, vector<uint8_t> const& pixels, unsigned int width, unsigned int height)
+{
+	// every scanline starts with filter type 0
+	vector<uint8_t> raw;
+	for (unsigned int y = 0; y < height; ++y) {
+		raw.push_back(0);
+		raw.insert(raw.end(), pixels.begin() + y * width, pixels.begin() + (y + 1) * width);
+	}
+
+	// zlib stream of stored deflate blocks, then the Adler-32 of the raw data
+	vector<uint8_t> zlib = { 0x78, 0x01 };
+	for (size_t offset = 0; offset < raw.size(); offset += 65535) {
+		size_t length = std::min<size_t>(65535, raw.size() - offset);
+		zlib.push_back(offset + length == raw.size() ? 1 : 0);
+		zlib.push_back(static_cast<uint8_t>(length));
+		zlib.push_back(static_cast<uint8_t>(length >> 8));
+		zlib.push_back(static_cast<uint8_t>(~length));
+		zlib.push_back(static_cast<uint8_t>(~length >> 8));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+	}
+
+	uint32_t a = 1, b = 0;
+	for (uint8_t byte : raw) {
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	PutBE32(zlib, (b << 16) | a);
+
+	vector<uint8_t> header;
+	PutBE32(header, width);
+	PutBE32(header, height);
+	header.insert(header.end(), { 8, 0, 0, 0, 0 });	// 8-bit greyscale, no interlacing
+
+	vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	PutChunk(png, "IHDR", header);
+	PutChunk(png, "IDAT", zlib);
+	PutChunk(png, "IEND", {});
+
+	ofstream file(filename, ios::binary);
+	file.write(reinterpret_cast<char const*>(png.data()), png.size());
+	return file.good();
+}
+
+// Function to convert a capture file to Y4M or PNG
+int ConvertCapture(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: capconv <Capture> <Output.y4m | PNG prefix> [Scale]\n";
+		return EXIT_FAILURE;
+	}
+
+	char const* captureFilename = argv[0];
+	string output = argv[1];
+	unsigned int scale = argc > 2 ? std::max(1ul, std::stoul(argv[2])) : 1;
+	bool y4m = output.size() > 4 && output.compare(output.size() - 4, 4, ".y4m") == 0;
+
+	CaptureReader reader;
+	if (!reader.Open(captureFilename)) {
+		std::cerr << "Not a capture file: " << captureFilename << "\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned int width = VIDEO_WIDTH * scale;
+	unsigned int height = VIDEO_HEIGHT * scale;
+
+	ofstream video;
+	if (y4m) {
+		video.open(output, ios::binary);
+		video << "YUV4MPEG2 W" << width << " H" << height << " F" << reader.FramesPerSecond() << ":1 Ip A1:1 Cmono\n";
+	}
+
+	CapturedFrame frame;
+	vector<uint8_t> previous;
+	uint32_t nextFrame = 0;
+	unsigned long records = 0;
+	unsigned long frames = 0;
+
+	// Function to append one output frame
+	auto emit = [&](vector<uint8_t> const& pixels) {
+		if (y4m) {
+			video << "FRAME\n";
+			video.write(reinterpret_cast<char const*>(pixels.data()), pixels.size());
+			++frames;
+			return true;
+		}
+
+		char number[16];
+		snprintf(number, sizeof(number), "_%06lu.png", frames++);
+		return WritePNG(output + number, pixels, width, height);
+	};
+
+	while (reader.Next(frame)) {
+		vector<uint8_t> pixels = ExpandFrame(frame, scale);
+
+		// frames dropped while recording show the last frame that made it
+		while (records > 0 && nextFrame < frame.frame) {
+			emit(previous);
+			++nextFrame;
+		}
+
+		if (!emit(pixels)) {
+			std::cerr << "Can't write frames to " << output << "\n";
+			return EXIT_FAILURE;
+		}
+
+		nextFrame = frame.frame + 1;
+		previous = pixels;
+		++records;
+	}
+
+	cout << "Converted " << records << " records into " << frames << " frames\n";
+	return 0;
+}
@@ -0,0 +1,146 @@
+// *********************************************************
+//
+//			   COPY-ON-WRITE CLONE SEARCH CHECK
+//
+// *********************************************************
+
+// Grows a random game tree the way a playtesting search would: pick a node, continue it for a few
+// frames with a random key held, and keep the result as a new node. The tree is grown once with
+// Chip8Cloner and once with full copies of the machine, with the same choices, and every node is
+// checked to hash the same both ways. It reports clones per second and the memory each one costs.
+
+// Libraries
+#include "tools.h"
+#include "clone.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// One expansion of the tree: the node to continue and the key to hold (KEY_COUNT is none)
+struct Expansion {
+	unsigned int node;
+	unsigned int key;
+};
+
+// Function to make the same random choices for both ways of growing the tree
+static vector<Expansion> PlanTree(unsigned int count)
+{
+	mt19937 rng(1);
+	vector<Expansion> plan(count);
+
+	for (unsigned int i = 0; i < count; ++i) {
+		// favour recent nodes, searches mostly extend the frontier
+		unsigned int nodes = i + 1;
+		unsigned int recent = std::min(nodes, 64u);
+		plan[i].node = (rng() % 4 != 0) ? nodes - 1 - rng() % recent : rng() % nodes;
+		plan[i].key = rng() % (KEY_COUNT + 1);
+	}
+
+	return plan;
+}
+
+// Function to hold one key, or none
+static void HoldKey(Chip8& chip8, unsigned int key)
+{
+	memset(chip8.keys, 0, KEY_COUNT);
+	if (key < KEY_COUNT) {
+		chip8.keys[key] = 1;
+	}
+}
+
+// Function to run a machine for a number of frames
+static void RunFrames(Chip8& chip8, unsigned int frames)
+{
+	for (unsigned int frame = 0; frame < frames; ++frame) {
+		if (chip8.RunUntilFrame().stop == STOP_FAULT) {
+			break;
+		}
+	}
+}
+
+// Function to grow a search tree with copy-on-write clones and check it against full copies
+int CloneSearch(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: clone <Clones> <ROM> [Frames per expansion]\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned int count = std::stoul(argv[0]);
+	char const* romFilename = argv[1];
+	unsigned int frames = argc > 2 ? std::stoul(argv[2]) : 4;
+
+	Chip8 root;
+	root.SeedRandom(0);
+	root.LoadROM(romFilename);
+
+	vector<Expansion> plan = PlanTree(count);
+
+	// copy-on-write: each node is a clone
+	Chip8Cloner cloner(root);
+	vector<shared_ptr<Chip8Clone const>> clones;
+	clones.reserve(count + 1);
+
+	auto start = std::chrono::steady_clock::now();
+	clones.push_back(cloner.Clone());
+	for (Expansion const& expansion : plan) {
+		cloner.Restore(*clones[expansion.node]);
+		HoldKey(cloner.Machine(), expansion.key);
+		RunFrames(cloner.Machine(), frames);
+		clones.push_back(cloner.Clone());
+	}
+	auto middle = std::chrono::steady_clock::now();
+	uint64_t pagesRestored = cloner.PagesRestored();
+
+	// full copies: each node is a whole machine
+	vector<unique_ptr<Chip8>> copies;
+	copies.reserve(count + 1);
+	copies.push_back(std::make_unique<Chip8>(root));
+	Chip8 working = root;
+	for (Expansion const& expansion : plan) {
+		working = *copies[expansion.node];
+		HoldKey(working, expansion.key);
+		RunFrames(working, frames);
+		copies.push_back(std::make_unique<Chip8>(working));
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	// every node restored from its clone must be the machine the full copy holds
+	unsigned int mismatches = 0;
+	for (size_t node = 0; node < clones.size(); ++node) {
+		cloner.Restore(*clones[node]);
+		if (cloner.Machine().StateHash() != copies[node]->StateHash()) {
+			if (mismatches++ < 5) {
+				printf("  node %zu differs from its full copy\n", node);
+			}
+		}
+	}
+
+	// new pages per clone beyond the root's, the root owns the first full set
+	size_t pageBytes = (cloner.PagesCloned() - MEMORY_PAGES) * MEMORY_PAGE_SIZE;
+	double cloneBytes = sizeof(Chip8Clone) + static_cast<double>(pageBytes) / count;
+
+	double cowTime = std::chrono::duration<double>(middle - start).count();
+	double copyTime = std::chrono::duration<double>(end - middle).count();
+
+	printf("%u expansions of %u frames of %s\n", count, frames, romFilename);
+	printf("  copy-on-write  %10.3f ms  %10.0f clones/s  %8.0f bytes per clone\n", cowTime * 1000.0, count / cowTime, cloneBytes);
+	printf("  full copies    %10.3f ms  %10.0f clones/s  %8zu bytes per clone\n", copyTime * 1000.0, count / copyTime, sizeof(Chip8));
+	printf("  pages copied %.2f per clone, restored %.2f per expansion\n",
+		static_cast<double>(cloner.PagesCloned() - MEMORY_PAGES) / count, static_cast<double>(pagesRestored) / count);
+
+	if (mismatches > 0) {
+		printf("FAIL: %u of %zu nodes differ from their full copies\n", mismatches, clones.size());
+		return EXIT_FAILURE;
+	}
+
+	printf("PASS every node matches its full copy\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+// *********************************************************
+//
+//			   BATCHED ENVIRONMENT BENCHMARK
+//
+// *********************************************************
+
+// Drives a ROM through the environment C API the way a training loop would, with random actions
+// every step, and reports environment steps per second for a range of worker thread counts.
+// Every run uses the same seeds and actions, so it also checks the observations, watched memory
+// and faults come out identical however the batch is split between threads.
+
+// Libraries
+#include "tools.h"
+#include "chip8env.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// memory bytes watched in the benchmark, the stack area most games keep their counters near
+const uint16_t ENV_BENCH_WATCHED[] = { 0x1F0, 0x1F1, 0x1F2, 0x1F3 };
+
+// keys a random action presses one of
+const unsigned int ENV_BENCH_KEYS = 16;
+
+// Function to fold a buffer into a running FNV-1a hash
+static uint64_t HashBytes(uint64_t hash, uint8_t const* data, size_t size)
+{
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ data[i]) * 0x100000001B3ull;
+	}
+	return hash;
+}
+
+// Function to run one batch with a given number of threads, returns steps per second
+static double TimeBatch(char const* romFilename, uint32_t count, uint32_t frames, uint32_t steps, uint32_t threads, uint64_t& hash)
+{
+	chip8_env* env = chip8_env_create(romFilename, count, threads);
+	if (env == nullptr) {
+		return -1.0;
+	}
+
+	chip8_env_watch_memory(env, ENV_BENCH_WATCHED, sizeof(ENV_BENCH_WATCHED) / sizeof(ENV_BENCH_WATCHED[0]));
+
+	// the same actions for every thread count, generated up front so they aren't timed
+	mt19937 rng(1);
+	vector<uint16_t> actions(static_cast<size_t>(count) * steps);
+	for (uint16_t& action : actions) {
+		action = static_cast<uint16_t>(1u << (rng() % ENV_BENCH_KEYS));
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t step = 0; step < steps; ++step) {
+		chip8_env_step(env, actions.data() + static_cast<size_t>(step) * count, frames);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	hash = 0xCBF29CE484222325ull;
+	hash = HashBytes(hash, chip8_env_observations(env), static_cast<size_t>(count) * CHIP8_ENV_OBSERVATION_BYTES);
+	hash = HashBytes(hash, chip8_env_memory(env), static_cast<size_t>(count) * (sizeof(ENV_BENCH_WATCHED) / sizeof(ENV_BENCH_WATCHED[0])));
+	hash = HashBytes(hash, chip8_env_faults(env), count);
+
+	chip8_env_destroy(env);
+
+	double seconds = std::chrono::duration<double>(end - start).count();
+	return static_cast<double>(count) * steps / seconds;
+}
+
+// Function to benchmark the environment API over thread counts
+int BenchEnvironments(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: envbench <Environments> <Steps> <ROM> [Frames] [MaxThreads]\n";
+		return EXIT_FAILURE;
+	}
+
+	uint32_t count = std::max(1ul, std::stoul(argv[0]));
+	uint32_t steps = std::max(1ul, std::stoul(argv[1]));
+	char const* romFilename = argv[2];
+	uint32_t frames = argc > 3 ? std::stoul(argv[3]) : 4;
+	uint32_t maxThreads = std::max(1ul, argc > 4 ? std::stoul(argv[4]) : std::thread::hardware_concurrency());
+
+	if (chip8_env_abi_version() != CHIP8_ENV_ABI_VERSION) {
+		std::cerr << "Environment library ABI " << chip8_env_abi_version() << " doesn't match " << CHIP8_ENV_ABI_VERSION << "\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << count << " environments of " << romFilename << ", " << steps << " steps of " << frames << " frames\n";
+
+	uint64_t expected = 0;
+	bool consistent = true;
+
+	// doubling the threads each run, ending on maxThreads
+	for (uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+		uint64_t hash = 0;
+		double rate = TimeBatch(romFilename, count, frames, steps, threads, hash);
+		if (rate < 0.0) {
+			std::cerr << "Couldn't create environments from " << romFilename << "\n";
+			return EXIT_FAILURE;
+		}
+
+		if (threads == 1) {
+			expected = hash;
+		}
+		bool same = hash == expected;
+		consistent = consistent && same;
+
+		printf("  %3u threads  %12.0f steps/s  %10.2f Mframes/s  %s\n", threads, rate, rate * frames / 1e6, same ? "" : "MISMATCH");
+
+		if (threads >= maxThreads) {
+			break;
+		}
+	}
+
+	cout << (consistent ? "PASS" : "FAIL") << ": outputs " << (consistent ? "identical" : "differ") << " across thread counts\n";
+	return consistent ? EXIT_SUCCESS : EXIT_FAILURE;
+}
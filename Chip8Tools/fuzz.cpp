@@ -0,0 +1,185 @@
+// *********************************************************
+//
+//				  ROM FUZZING HARNESS
+//
+// *********************************************************
+
+// Runs arbitrary bytes as a ROM to shake out memory errors in the core.
+// LLVMFuzzerTestOneInput is the libFuzzer entry point, build it without tools.cpp:
+//   clang++ -O2 -g -fsanitize=fuzzer,address,undefined -fno-sanitize-recover=all -I../Chip8Emu fuzz.cpp ../Chip8Emu/chip8.cpp ../Chip8Emu/debugger.cpp ../Chip8Emu/trace.cpp
+// "Chip8Tools fuzz" drives the same harness with a simple built-in mutator and reports
+// executions per second, for builds where libFuzzer isn't available. Run it from a build
+// configured with -DCHIP8_SANITIZE=address,undefined: a stray index into memory lands in the
+// machine's next array rather than outside the object, which only UBSan's bounds check sees.
+
+// Libraries
+#include "tools.h"
+#include "chip8.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// instructions run per input, enough to get through a typical ROM's setup and into its main loop
+const unsigned int FUZZ_CYCLES = 2000;
+
+// largest input the built-in mutator grows to, everything past the end of memory is dropped anyway
+const size_t FUZZ_MAX_SIZE = MEMORY_SIZE - 0x200;
+
+// Function to return the machine every input starts from
+static Chip8 const& Pristine()
+{
+	// seeded so the same input always runs the same way
+	static Chip8 const pristine = [] {
+		Chip8 chip8;
+		chip8.SeedRandom(0);
+		return chip8;
+	}();
+
+	return pristine;
+}
+
+// Function to run one input as a ROM from a clean machine
+static Chip8Fault RunInput(Chip8& chip8, uint8_t const* data, size_t size)
+{
+	// Chip8 is a flat block of memory, so copying the pristine one over it is a single memcpy
+	// and the seeded generator state comes along with it
+	chip8 = Pristine();
+	chip8.LoadROM(data, size);
+	chip8.RunCycles(FUZZ_CYCLES);
+
+	return chip8.GetFault();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size)
+{
+	static Chip8 chip8;
+	RunInput(chip8, data, size);
+	return 0;
+}
+
+// Function to change a few bytes of an input, or grow or shrink it
+static void Mutate(vector<uint8_t>& input, std::mt19937& rng)
+{
+	unsigned int changes = 1 + rng() % 8;
+
+	for (unsigned int i = 0; i < changes; i++) {
+		switch (rng() % 4) {
+		case 0:
+			// flip a bit
+			if (!input.empty()) {
+				input[rng() % input.size()] ^= 1u << (rng() % 8);
+			}
+			break;
+
+		case 1:
+			// overwrite a byte
+			if (!input.empty()) {
+				input[rng() % input.size()] = static_cast<uint8_t>(rng());
+			}
+			break;
+
+		case 2:
+			// append a whole random instruction
+			if (input.size() + 2 <= FUZZ_MAX_SIZE) {
+				input.push_back(static_cast<uint8_t>(rng()));
+				input.push_back(static_cast<uint8_t>(rng()));
+			}
+			break;
+
+		case 3:
+			// drop the tail
+			if (input.size() > 2) {
+				input.resize(input.size() - 2);
+			}
+			break;
+		}
+	}
+}
+
+// Function to time how long resetting a machine takes each way, in nanoseconds
+static void TimeReset(double& copyTime, double& constructTime)
+{
+	const unsigned int resets = 20000;
+	uint8_t rom[2] = { 0x12, 0x00 };
+	Chip8 chip8;
+
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < resets; i++) {
+		chip8 = Pristine();
+		chip8.LoadROM(rom, sizeof(rom));
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < resets; i++) {
+		auto fresh = std::make_unique<Chip8>();
+		fresh->SeedRandom(0);
+		fresh->LoadROM(rom, sizeof(rom));
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	copyTime = std::chrono::duration<double, std::nano>(middle - start).count() / resets;
+	constructTime = std::chrono::duration<double, std::nano>(end - middle).count() / resets;
+}
+
+// Function to fuzz the core with mutated ROMs for a number of seconds
+int FuzzROMs(int argc, char* argv[])
+{
+	if (argc < 1)
+	{
+		std::cerr << "Usage: fuzz <Seconds> [Seed ROM]...\n";
+		return EXIT_FAILURE;
+	}
+
+	double seconds = std::stod(argv[0]);
+	std::mt19937 rng(1);
+
+	// seed inputs, or a block of random bytes
+	vector<vector<uint8_t>> seeds;
+	for (int i = 1; i < argc; i++) {
+		ifstream file(argv[i], ios::binary);
+		if (!file) {
+			std::cerr << "Can't open " << argv[i] << "\n";
+			return EXIT_FAILURE;
+		}
+		seeds.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	if (seeds.empty()) {
+		seeds.emplace_back(512);
+		for (auto& byte : seeds.back()) {
+			byte = static_cast<uint8_t>(rng());
+		}
+	}
+
+	Chip8 chip8;
+	vector<uint8_t> input;
+	unsigned long executions = 0;
+	unsigned long faults[3] = {};
+
+	auto start = std::chrono::steady_clock::now();
+	auto deadline = start + std::chrono::duration<double>(seconds);
+
+	// the clock is only read every so often, it costs about as much as a short input
+	while (std::chrono::steady_clock::now() < deadline) {
+		for (unsigned int i = 0; i < 256; i++) {
+			input = seeds[rng() % seeds.size()];
+			Mutate(input, rng);
+
+			++faults[RunInput(chip8, input.data(), input.size())];
+			++executions;
+		}
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double copyTime;
+	double constructTime;
+	TimeReset(copyTime, constructTime);
+
+	printf("%lu executions in %.1f s, %.0f exec/s (%u instructions each)\n", executions, elapsed, executions / elapsed, FUZZ_CYCLES);
+	printf("  stack overflows %lu, stack underflows %lu\n", faults[FAULT_STACK_OVERFLOW], faults[FAULT_STACK_UNDERFLOW]);
+	printf("  reset by copy %.0f ns, by construction %.0f ns\n", copyTime, constructTime);
+	return 0;
+}
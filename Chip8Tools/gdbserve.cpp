@@ -0,0 +1,40 @@
+// *********************************************************
+//
+//			   GDB SERVER FOR A HEADLESS MACHINE
+//
+// *********************************************************
+
+// Loads a ROM and waits for gdb (or any remote serial protocol client) to attach on localhost.
+
+// Libraries
+#include "tools.h"
+#include "gdbstub.h"
+#include <string>
+
+using namespace std;
+
+// Function to serve a ROM to a remote debugger
+int DebugROM(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: gdb <Port> <ROM>\n";
+		return EXIT_FAILURE;
+	}
+
+	uint16_t port = static_cast<uint16_t>(std::stoul(argv[0]));
+
+	Chip8 chip8;
+	chip8.LoadROM(argv[1]);
+
+	GdbStub stub(chip8);
+	cout << "Waiting for a debugger on 127.0.0.1:" << port << "\n";
+
+	if (!stub.Serve(port)) {
+		std::cerr << "Can't serve on port " << port << "\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "Debugger detached\n";
+	return 0;
+}
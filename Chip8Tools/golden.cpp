@@ -0,0 +1,191 @@
+// *********************************************************
+//
+//			   GOLDEN FRAME REGRESSION HARNESS
+//
+// *********************************************************
+
+// Runs a ROM headless for a number of frames, feeding keys from a scripted input log, and hashes
+// the display after every frame. The hashes are recorded once as a golden file and later runs are
+// checked against it, reporting the first frame that diverges.
+
+// Golden file format (text):
+//   cycles <instructions per frame>
+//   <frame hash in hex>, one line per frame
+// Input log format (text): "<frame> <key in hex> <1 = down, 0 = up>" per line, # starts a comment
+
+// Libraries
+#include "tools.h"
+#include "chip8.h"
+#include "framehash.h"
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const unsigned int DEFAULT_FRAMES = 120;
+
+// Scripted key change applied at the start of a frame
+struct InputEvent {
+	unsigned int frame;
+	uint8_t key;
+	uint8_t down;
+};
+
+// Function to read an input log, returns false if it can't be opened
+static bool LoadInputs(char const* filename, vector<InputEvent>& inputs)
+{
+	ifstream file(filename);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	string line;
+	while (getline(file, line)) {
+		line = line.substr(0, line.find('#'));
+
+		istringstream fields(line);
+		unsigned int frame, key, down;
+		if (fields >> frame >> hex >> key >> dec >> down) {
+			inputs.push_back({ frame, static_cast<uint8_t>(key & 0xFu), static_cast<uint8_t>(down ? 1 : 0) });
+		}
+	}
+
+	return true;
+}
+
+// Function to run a ROM for frames frames and hash the display after each one
+static vector<uint64_t> RunFrames(char const* romFilename, unsigned int frames, unsigned int cyclesPerFrame,
+	vector<InputEvent> const& inputs, bool reference, Chip8& chip8)
+{
+	vector<uint64_t> hashes;
+	FrameHasher hasher;
+	size_t nextInput = 0;
+
+	chip8.SetFusion(!reference);
+	chip8.SetCyclesPerFrame(cyclesPerFrame);
+	chip8.LoadROM(romFilename);
+
+	for (unsigned int frame = 0; frame < frames; frame++) {
+		while (nextInput < inputs.size() && inputs[nextInput].frame <= frame) {
+			chip8.keys[inputs[nextInput].key] = inputs[nextInput].down;
+			nextInput++;
+		}
+
+		if (reference) {
+			for (unsigned int i = 0; i < cyclesPerFrame; i++) {
+				chip8.Cycle();
+			}
+		}
+		else {
+			chip8.RunUntilFrame();
+		}
+
+		hashes.push_back(hasher.Update(chip8.display, chip8.TakeDirtyRows()));
+	}
+
+	return hashes;
+}
+
+// Function to print the display as text
+static void PrintFrame(Chip8 const& chip8)
+{
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; row++) {
+		string line;
+		for (unsigned int col = 0; col < VIDEO_WIDTH; col++) {
+			line += ((chip8.display[row] >> (VIDEO_WIDTH - 1 - col)) & 1u) ? '#' : '.';
+		}
+		cout << "  " << line << "\n";
+	}
+}
+
+// Function to record or check golden frame hashes
+int GoldenFrames(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: golden record <ROM> <Golden> [Frames] [Cycles per frame] [Inputs]\n";
+		std::cerr << "       golden check <ROM> <Golden> [Inputs] [--reference]\n";
+		return EXIT_FAILURE;
+	}
+
+	string mode = argv[0];
+	char const* romFilename = argv[1];
+	char const* goldenFilename = argv[2];
+	vector<InputEvent> inputs;
+
+	if (mode == "record")
+	{
+		unsigned int frames = argc > 3 ? std::stoul(argv[3]) : DEFAULT_FRAMES;
+		unsigned int cyclesPerFrame = argc > 4 ? std::stoul(argv[4]) : DEFAULT_CYCLES_PER_FRAME;
+
+		if (argc > 5 && !LoadInputs(argv[5], inputs)) {
+			std::cerr << "Can't read input log " << argv[5] << "\n";
+			return EXIT_FAILURE;
+		}
+
+		// goldens always come from the plain one-instruction-at-a-time interpreter
+		Chip8 chip8;
+		vector<uint64_t> hashes = RunFrames(romFilename, frames, cyclesPerFrame, inputs, true, chip8);
+
+		ofstream golden(goldenFilename);
+		golden << "cycles " << cyclesPerFrame << "\n";
+		for (uint64_t hash : hashes) {
+			golden << hex << hash << "\n";
+		}
+
+		cout << "Recorded " << frames << " frames of " << romFilename << " to " << goldenFilename << "\n";
+		return 0;
+	}
+
+	if (mode == "check")
+	{
+		bool reference = false;
+		for (int i = 3; i < argc; i++) {
+			if (string(argv[i]) == "--reference") {
+				reference = true;
+			}
+			else if (!LoadInputs(argv[i], inputs)) {
+				std::cerr << "Can't read input log " << argv[i] << "\n";
+				return EXIT_FAILURE;
+			}
+		}
+
+		ifstream golden(goldenFilename);
+		string keyword;
+		unsigned int cyclesPerFrame = 0;
+		if (!(golden >> keyword >> cyclesPerFrame) || keyword != "cycles") {
+			std::cerr << "Not a golden file: " << goldenFilename << "\n";
+			return EXIT_FAILURE;
+		}
+
+		vector<uint64_t> expected;
+		uint64_t hash;
+		while (golden >> hex >> hash) {
+			expected.push_back(hash);
+		}
+
+		Chip8 chip8;
+		vector<uint64_t> actual = RunFrames(romFilename, static_cast<unsigned int>(expected.size()), cyclesPerFrame, inputs, reference, chip8);
+
+		for (size_t frame = 0; frame < expected.size(); frame++) {
+			if (actual[frame] != expected[frame]) {
+				printf("FAIL %s: frame %zu diverges (expected %016llx, got %016llx)\n", romFilename, frame,
+					(unsigned long long)expected[frame], (unsigned long long)actual[frame]);
+
+				// replay up to the diverging frame to show what was on screen
+				Chip8 diverged;
+				RunFrames(romFilename, static_cast<unsigned int>(frame + 1), cyclesPerFrame, inputs, reference, diverged);
+				PrintFrame(diverged);
+				return EXIT_FAILURE;
+			}
+		}
+
+		printf("PASS %s: %zu frames\n", romFilename, expected.size());
+		return 0;
+	}
+
+	std::cerr << "Unknown golden mode: " << mode << "\n";
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,87 @@
+// *********************************************************
+//
+//			 LOCKSTEP CHECK OF THE FAST ENGINE
+//
+// *********************************************************
+
+// Runs every ROM of a corpus on the fast engine (RunCycles with fusion and idle-loop skipping) in
+// lockstep with the reference interpreter, pressing keys now and then so ROMs waiting for input
+// get past it, and reports the first ROM state where the two disagree.
+
+// Libraries
+#include "tools.h"
+#include "lockstep.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+// Function to script the keys of a frame: a short press of a different key every so often
+static void ScriptKeys(uint64_t frame, uint8_t* keys)
+{
+	memset(keys, 0, KEY_COUNT);
+	if (frame % 61 < 3) {
+		keys[(frame / 61) % KEY_COUNT] = 1;
+	}
+}
+
+// Function to run a ROM corpus through the lockstep checker
+int CheckLockstep(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: lockstep <Interval> <Cycles> <ROM>...\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned int interval = std::stoul(argv[0]);
+	uint64_t cycles = std::stoull(argv[1]);
+	uint64_t frames = (cycles + DEFAULT_CYCLES_PER_FRAME - 1) / DEFAULT_CYCLES_PER_FRAME;
+	unsigned int failures = 0;
+	double checkedTime = 0.0;
+	double engineTime = 0.0;
+
+	for (int rom = 2; rom < argc; rom++) {
+		// machines are big enough that the stack isn't the place for them
+		auto chip8 = std::make_unique<Chip8>();
+		chip8->SeedRandom(0);
+		chip8->LoadROM(argv[rom]);
+		auto alone = std::make_unique<Chip8>(*chip8);
+
+		LockstepChecker checker(*chip8, interval);
+
+		auto start = std::chrono::steady_clock::now();
+		bool passed = true;
+		for (uint64_t frame = 0; frame < frames && passed; frame++) {
+			ScriptKeys(frame, chip8->keys);
+			passed = checker.Run(DEFAULT_CYCLES_PER_FRAME);
+		}
+		passed = passed && checker.Check();
+		auto middle = std::chrono::steady_clock::now();
+
+		// the same run without the checker, for the overhead
+		for (uint64_t frame = 0; frame < frames; frame++) {
+			ScriptKeys(frame, alone->keys);
+			alone->RunCycles(DEFAULT_CYCLES_PER_FRAME);
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		checkedTime += std::chrono::duration<double>(middle - start).count();
+		engineTime += std::chrono::duration<double>(end - middle).count();
+
+		if (passed) {
+			printf("PASS %s: %llu instructions, %llu comparisons\n", argv[rom],
+				static_cast<unsigned long long>(checker.Executed()), static_cast<unsigned long long>(checker.Comparisons()));
+		}
+		else {
+			printf("FAIL %s: %s", argv[rom], checker.Report().c_str());
+			++failures;
+		}
+	}
+
+	printf("engine alone %.3f ms, in lockstep every %u instructions %.3f ms\n", engineTime * 1000.0, interval, checkedTime * 1000.0);
+	return failures ? EXIT_FAILURE : 0;
+}
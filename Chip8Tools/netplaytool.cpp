@@ -0,0 +1,261 @@
+// *********************************************************
+//
+//			     ROLLBACK NETPLAY TOOLS
+//
+// *********************************************************
+
+// peer: one side of a scripted two-player session, for running the two sides by hand
+// test: forks the two sides of a session over loopback UDP with simulated latency and packet loss,
+//       then checks both ended on the machine a local run with the same keys ends on
+
+// Libraries
+#include "tools.h"
+#include "netplay.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+
+const double NETPLAY_FRAME_SECONDS = 1.0 / 60.0;
+
+// how long a side waits for the other to confirm the last frames before giving up
+const double NETPLAY_SETTLE_SECONDS = 5.0;
+
+const uint32_t NETPLAY_TEST_SEED = 1234;
+
+// Function to give the keys a scripted player holds on a frame: a key of their half of the keypad,
+// or none, changing every few frames
+static uint16_t ScriptedKeys(unsigned int player, uint32_t frame)
+{
+	uint32_t x = (frame / 7) * 2654435761u + player * 40503u + 1;
+	x ^= x >> 15;
+	x *= 2246822519u;
+	x ^= x >> 13;
+
+	unsigned int key = x % 9;
+	if (key == 8) {
+		return 0;
+	}
+	return static_cast<uint16_t>(1u << (player * 8 + key));
+}
+
+// Function to load the machine both sides start from
+static bool StartMachine(Chip8& chip8, char const* romFilename)
+{
+	ifstream rom(romFilename);
+	if (!rom.good()) {
+		std::cerr << "Can't read " << romFilename << "\n";
+		return false;
+	}
+
+	chip8.SeedRandom(NETPLAY_TEST_SEED);
+	chip8.LoadROM(romFilename);
+	return true;
+}
+
+// Function to play one side at 60 frames per second, then wait until every frame is confirmed
+static bool PlaySide(NetplaySession& session, unsigned int player, uint32_t frames, unsigned int latencyMs)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	while (session.Frame() < frames) {
+		auto due = start + std::chrono::duration<double>(session.Frame() * NETPLAY_FRAME_SECONDS);
+		std::this_thread::sleep_until(due);
+
+		while (!session.Advance(ScriptedKeys(player, session.Frame()))) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	// both sides need the other's last keys, and to hear that their own arrived
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(NETPLAY_SETTLE_SECONDS);
+	while (session.ConfirmedFrames() < frames || session.Acknowledged() < frames) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+		session.Idle();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	// and the other side to hear that its keys arrived
+	auto linger = std::chrono::steady_clock::now() + std::chrono::milliseconds(2 * latencyMs + 100);
+	while (std::chrono::steady_clock::now() < linger) {
+		session.Idle();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return true;
+}
+
+// Function to report what one side's session did
+static void PrintStats(unsigned int player, NetplaySession const& session)
+{
+	NetplayStats const& stats = session.Stats();
+	double meanUs = stats.rollbacks ? stats.rollbackNs / 1000.0 / stats.rollbacks : 0.0;
+
+	printf("  player %u: %llu frames, %llu stalls, %llu rollbacks running %llu frames again (longest %u)\n", player + 1,
+		static_cast<unsigned long long>(stats.frames), static_cast<unsigned long long>(stats.stalls),
+		static_cast<unsigned long long>(stats.rollbacks), static_cast<unsigned long long>(stats.resimulated), stats.longestRollback);
+	printf("            rollback %.1f us mean, %.1f us worst, of a %.0f us frame\n",
+		meanUs, stats.maxRollbackNs / 1000.0, NETPLAY_FRAME_SECONDS * 1e6);
+	printf("            packets %llu sent, %llu lost, %llu received, %llu ignored, %llu hashes checked, %llu desyncs\n",
+		static_cast<unsigned long long>(stats.packetsSent), static_cast<unsigned long long>(stats.packetsLost),
+		static_cast<unsigned long long>(stats.packetsReceived), static_cast<unsigned long long>(stats.packetsIgnored),
+		static_cast<unsigned long long>(stats.hashesChecked), static_cast<unsigned long long>(stats.desyncs));
+}
+
+// Function to run one scripted side against another process
+static int Peer(int argc, char* argv[])
+{
+	if (argc < 5)
+	{
+		std::cerr << "Usage: netplay peer <ROM> <Player 1|2> <Port> <Host> <Remote port> [Frames] [Latency ms] [Loss %]\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned int player = std::stoul(argv[1]) == 2 ? 1 : 0;
+	uint32_t frames = argc > 5 ? std::stoul(argv[5]) : 600;
+	unsigned int latencyMs = argc > 6 ? std::stoul(argv[6]) : 0;
+	unsigned int lossPercent = argc > 7 ? std::stoul(argv[7]) : 0;
+
+	Chip8 start;
+	if (!StartMachine(start, argv[0])) {
+		return EXIT_FAILURE;
+	}
+
+	NetplaySession session(start);
+	if (!session.Open(static_cast<uint16_t>(std::stoul(argv[2]))) || !session.Connect(argv[3], static_cast<uint16_t>(std::stoul(argv[4])))) {
+		std::cerr << "Can't open UDP port " << argv[2] << " to " << argv[3] << ":" << argv[4] << "\n";
+		return EXIT_FAILURE;
+	}
+	session.SetLink(latencyMs, lossPercent, player + 1);
+
+	bool settled = PlaySide(session, player, frames, latencyMs);
+	PrintStats(player, session);
+	printf("  state hash %016llx after frame %u%s\n", static_cast<unsigned long long>(session.Machine().StateHash()),
+		session.Frame(), settled ? "" : ", last frames unconfirmed");
+
+	return settled && session.Stats().desyncs == 0 ? 0 : EXIT_FAILURE;
+}
+
+// Function to check two forked sides against each other and against a local run
+static int Test(int argc, char* argv[])
+{
+	if (argc < 1)
+	{
+		std::cerr << "Usage: netplay test <ROM> [Frames] [Latency ms] [Loss %]\n";
+		return EXIT_FAILURE;
+	}
+
+	uint32_t frames = argc > 1 ? std::stoul(argv[1]) : 300;
+	unsigned int latencyMs = argc > 2 ? std::stoul(argv[2]) : 40;
+	unsigned int lossPercent = argc > 3 ? std::stoul(argv[3]) : 10;
+
+	Chip8 start;
+	if (!StartMachine(start, argv[0])) {
+		return EXIT_FAILURE;
+	}
+
+	// what both sides should end on: the same keys, all known up front
+	Chip8 local = start;
+	for (uint32_t frame = 0; frame < frames; ++frame) {
+		uint16_t held = ScriptedKeys(0, frame) | ScriptedKeys(1, frame);
+		for (unsigned int key = 0; key < KEY_COUNT; ++key) {
+			local.keys[key] = (held >> key) & 1u;
+		}
+		local.RunUntilFrame();
+	}
+	uint64_t expected = local.StateHash();
+
+	// both sockets are bound before forking, so neither side sends to a port that isn't open yet
+	NetplaySession first(start);
+	NetplaySession second(start);
+	if (!first.Open(0) || !second.Open(0) ||
+		!first.Connect("127.0.0.1", second.Port()) || !second.Connect("127.0.0.1", first.Port())) {
+		std::cerr << "FAIL: can't open loopback UDP sockets\n";
+		return EXIT_FAILURE;
+	}
+
+	printf("%u frames of %s over loopback UDP, %u ms latency, %u%% loss each way\n", frames, argv[0], latencyMs, lossPercent);
+	fflush(stdout);
+
+	int hashPipe[2];
+	if (pipe(hashPipe) < 0) {
+		std::cerr << "FAIL: can't make a pipe\n";
+		return EXIT_FAILURE;
+	}
+
+	pid_t child = fork();
+	if (child == 0) {
+		close(hashPipe[0]);
+		NetplaySession& session = second;
+		session.SetLink(latencyMs, lossPercent, 2);
+
+		bool settled = PlaySide(session, 1, frames, latencyMs);
+		uint64_t hash = session.Machine().StateHash();
+		PrintStats(1, session);
+		fflush(stdout);
+
+		bool written = write(hashPipe[1], &hash, sizeof(hash)) == static_cast<ssize_t>(sizeof(hash));
+		// _exit skips stdio's buffers
+		_exit(settled && written && session.Stats().desyncs == 0 ? 0 : 1);
+	}
+	close(hashPipe[1]);
+
+	NetplaySession& session = first;
+	session.SetLink(latencyMs, lossPercent, 1);
+	bool settled = PlaySide(session, 0, frames, latencyMs);
+	uint64_t hash = session.Machine().StateHash();
+
+	uint64_t remoteHash = 0;
+	bool received = read(hashPipe[0], &remoteHash, sizeof(remoteHash)) == static_cast<ssize_t>(sizeof(remoteHash));
+	close(hashPipe[0]);
+
+	int status = 0;
+	waitpid(child, &status, 0);
+	PrintStats(0, session);
+
+	bool passed = settled && received && WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+		session.Stats().desyncs == 0 && hash == expected && remoteHash == expected;
+
+	printf("  state hash %016llx, player 2 %016llx, local run %016llx\n", static_cast<unsigned long long>(hash),
+		static_cast<unsigned long long>(remoteHash), static_cast<unsigned long long>(expected));
+	printf("%s both sides end on the local run's machine\n", passed ? "PASS" : "FAIL");
+	return passed ? 0 : EXIT_FAILURE;
+}
+
+// Function to run the netplay subcommands
+int Netplay(int argc, char* argv[])
+{
+	string mode = argc > 0 ? argv[0] : "";
+
+	if (mode == "peer") {
+		return Peer(argc - 1, argv + 1);
+	}
+	if (mode == "test") {
+		return Test(argc - 1, argv + 1);
+	}
+
+	std::cerr << "Usage: netplay peer|test ...\n";
+	return EXIT_FAILURE;
+}
+
+#else
+
+// Function to report that netplay needs Linux
+int Netplay(int, char*[])
+{
+	std::cerr << "netplay needs Linux\n";
+	return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,147 @@
+// *********************************************************
+//
+//			   OPCODE SEQUENCE MINING TOOL
+//
+// *********************************************************
+
+// Runs every ROM of a corpus headless and counts which opcode pairs and triples are executed
+// most often. The top of this list is what's worth turning into a superinstruction.
+
+// Libraries
+#include "tools.h"
+#include "chip8.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Function to name the instruction an opcode decodes to, e.g. 0xA2F0 -> "Annn"
+static string OpcodeClass(uint16_t opcode)
+{
+	switch ((opcode & 0xF000u) >> 12u) {
+	case 0x0:
+		if (opcode == 0x00E0u) return "00E0";
+		if (opcode == 0x00EEu) return "00EE";
+		return "0nnn";
+	case 0x1: return "1nnn";
+	case 0x2: return "2nnn";
+	case 0x3: return "3xkk";
+	case 0x4: return "4xkk";
+	case 0x5: return "5xy0";
+	case 0x6: return "6xkk";
+	case 0x7: return "7xkk";
+	case 0x8: {
+		const char* names[] = { "8xy0", "8xy1", "8xy2", "8xy3", "8xy4", "8xy5", "8xy6", "8xy7" };
+		uint8_t low = opcode & 0x000Fu;
+		if (low < 8) return names[low];
+		if (low == 0xE) return "8xyE";
+		break;
+	}
+	case 0x9: return "9xy0";
+	case 0xA: return "Annn";
+	case 0xB: return "Bnnn";
+	case 0xC: return "Cxkk";
+	case 0xD: return "Dxyn";
+	case 0xE:
+		if ((opcode & 0x00FFu) == 0x9Eu) return "Ex9E";
+		if ((opcode & 0x00FFu) == 0xA1u) return "ExA1";
+		break;
+	case 0xF: {
+		const uint8_t lows[] = { 0x07, 0x0A, 0x15, 0x18, 0x1E, 0x29, 0x33, 0x55, 0x65 };
+		for (uint8_t low : lows) {
+			if ((opcode & 0x00FFu) == low) {
+				char name[5];
+				snprintf(name, sizeof(name), "Fx%02X", low);
+				return name;
+			}
+		}
+		break;
+	}
+	}
+
+	return "????";
+}
+
+// Function to print the most frequent entries of a sequence histogram
+static void PrintTop(char const* title, map<string, uint64_t> const& counts, uint64_t total, size_t limit)
+{
+	vector<pair<string, uint64_t>> sorted(counts.begin(), counts.end());
+	sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) { return a.second > b.second; });
+
+	cout << title << "\n";
+	for (size_t i = 0; i < sorted.size() && i < limit; i++) {
+		printf("  %-16s %12llu  %5.1f%%\n", sorted[i].first.c_str(),
+			(unsigned long long)sorted[i].second, 100.0 * sorted[i].second / total);
+	}
+}
+
+// Function to mine executed opcode pairs and triples
+int MineOpcodes(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: mine <Cycles> <ROM>...\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned long cycles = std::stoul(argv[0]);
+
+	map<string, uint64_t> singles;
+	map<string, uint64_t> pairs;
+	map<string, uint64_t> triples;
+	uint64_t total = 0;
+
+	for (int rom = 1; rom < argc; rom++) {
+		ifstream check(argv[rom], ios::binary);
+		if (!check.is_open()) {
+			std::cerr << "Skipping unreadable ROM: " << argv[rom] << "\n";
+			continue;
+		}
+
+		// plain dispatch, so every instruction is observed on its own
+		Chip8 chip8;
+		chip8.SetFusion(false);
+		chip8.LoadROM(argv[rom]);
+
+		string previous[2];
+		for (unsigned long i = 0; i < cycles; i++) {
+			uint16_t pc = chip8.GetProgramCounter();
+			uint16_t opcode = (chip8.ReadMemory(pc) << 8u) | chip8.ReadMemory(pc + 1);
+
+			// a jump to itself is how ROMs halt, the rest of the budget would only skew the counts
+			if (opcode == (0x1000u | pc)) {
+				break;
+			}
+
+			string name = OpcodeClass(opcode);
+
+			singles[name]++;
+			if (!previous[1].empty()) {
+				pairs[previous[1] + " " + name]++;
+			}
+			if (!previous[0].empty()) {
+				triples[previous[0] + " " + previous[1] + " " + name]++;
+			}
+			previous[0] = previous[1];
+			previous[1] = name;
+			total++;
+
+			chip8.Cycle();
+		}
+	}
+
+	if (total == 0) {
+		std::cerr << "No instructions executed\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "Executed " << total << " instructions\n";
+	PrintTop("Instructions:", singles, total, 20);
+	PrintTop("Pairs:", pairs, total, 20);
+	PrintTop("Triples:", triples, total, 20);
+
+	return 0;
+}
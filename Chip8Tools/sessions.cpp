@@ -0,0 +1,106 @@
+// *********************************************************
+//
+//			   MULTI-SESSION SCHEDULER CHECK
+//
+// *********************************************************
+
+// Runs many sessions through the coroutine Scheduler and the same sessions stepped every frame,
+// with scripted key presses, then checks they end in the same state and reports how much work
+// the scheduler skipped.
+
+// Libraries
+#include "tools.h"
+#include "debugger.h"
+#include "scheduler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const unsigned int SESSION_CYCLES_PER_FRAME = 10;
+
+// Function to script a session's keys: a short press of one key every so often
+static void ScriptKeys(unsigned int session, uint64_t frame, uint8_t* keys)
+{
+	memset(keys, 0, KEY_COUNT);
+	if ((frame + session * 7) % 97 < 4) {
+		keys[session % KEY_COUNT] = 1;
+	}
+}
+
+// Function to schedule many sessions and compare them against stepping every machine every frame
+int RunSessions(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: sessions <Count> <Frames> <ROM>...\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned int count = std::stoul(argv[0]);
+	uint64_t frames = std::stoull(argv[1]);
+	uint8_t keys[KEY_COUNT];
+
+	// sessions take the ROMs in turn
+	Scheduler scheduler(SESSION_CYCLES_PER_FRAME);
+	vector<std::unique_ptr<Chip8>> stepped;
+	for (unsigned int i = 0; i < count; i++) {
+		char const* rom = argv[2 + i % (argc - 2)];
+		scheduler.AddSession(rom);
+
+		stepped.push_back(std::make_unique<Chip8>());
+		stepped.back()->SeedRandom(i);
+		stepped.back()->LoadROM(rom);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t frame = 1; frame <= frames; frame++) {
+		for (unsigned int i = 0; i < count; i++) {
+			ScriptKeys(i, frame, keys);
+			scheduler.SetKeys(i, keys);
+		}
+		scheduler.RunFrame();
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (uint64_t frame = 1; frame <= frames; frame++) {
+		for (unsigned int i = 0; i < count; i++) {
+			ScriptKeys(i, frame, stepped[i]->keys);
+			stepped[i]->RunCycles(SESSION_CYCLES_PER_FRAME);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	double scheduledTime = std::chrono::duration<double>(middle - start).count();
+	double steppedTime = std::chrono::duration<double>(end - middle).count();
+
+	printf("%u sessions for %llu frames\n", count, static_cast<unsigned long long>(frames));
+	printf("  scheduler  %10.3f ms  %llu resumes (%.1f%% of session frames)\n", scheduledTime * 1000.0,
+		static_cast<unsigned long long>(scheduler.Resumes()), 100.0 * scheduler.Resumes() / (static_cast<double>(frames) * count));
+	printf("  stepped    %10.3f ms\n", steppedTime * 1000.0);
+
+	// the scheduler may only skip work, never change what a session does
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		Debugger::Registers scheduled = Debugger::ReadRegisters(scheduler.Machine(i));
+		Debugger::Registers expected = Debugger::ReadRegisters(*stepped[i]);
+		bool sameRegisters = memcmp(scheduled.v, expected.v, sizeof(scheduled.v)) == 0 && scheduled.index == expected.index &&
+			scheduled.pc == expected.pc && scheduled.sp == expected.sp && scheduled.delay == expected.delay && scheduled.sound == expected.sound;
+
+		if (!sameRegisters ||
+			memcmp(scheduler.Machine(i).display, stepped[i]->display, sizeof(stepped[i]->display)) != 0) {
+			printf("MISMATCH session %u\n", i);
+			++mismatches;
+		}
+	}
+
+	if (mismatches) {
+		return EXIT_FAILURE;
+	}
+
+	printf("PASS every session matches\n");
+	return 0;
+}
@@ -0,0 +1,192 @@
+// *********************************************************
+//
+//			  SHARED MEMORY STATE CONSUMER
+//
+// *********************************************************
+
+// view: a sample consumer, draws an instance exported by "Chip8Emu --export" and shows its registers
+// test: one process publishes as fast as it can while a forked reader checks every snapshot is whole
+
+// Libraries
+#include "tools.h"
+#include "sharedexport.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+
+// Function to print a snapshot as text, display first and registers under it
+static void DrawSnapshot(SharedSnapshot const& snapshot)
+{
+	string text = "\x1b[H";
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		for (unsigned int col = 0; col < VIDEO_WIDTH; ++col) {
+			text += (snapshot.rows[row] >> (63 - col)) & 1u ? '#' : ' ';
+		}
+		text += "\n";
+	}
+
+	char line[128];
+	for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+		snprintf(line, sizeof(line), "V%X=%02X%s", i, snapshot.v[i], i % 8 == 7 ? "\n" : " ");
+		text += line;
+	}
+	snprintf(line, sizeof(line), "I=%03X PC=%03X SP=%X DT=%02X ST=%02X  frame %llu   \n",
+		snapshot.index, snapshot.pc, snapshot.sp, snapshot.delay, snapshot.sound, static_cast<unsigned long long>(snapshot.frame));
+	text += line;
+
+	cout << text << std::flush;
+}
+
+// Function to draw an exported instance whenever it publishes a new frame
+static int View(int argc, char* argv[])
+{
+	if (argc < 1)
+	{
+		std::cerr << "Usage: shm view <Name> [Instance]\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned int instance = argc > 1 ? std::stoul(argv[1]) : 0;
+	SharedStateReader reader;
+	if (!reader.Open(argv[0]) || instance >= reader.Instances()) {
+		std::cerr << "No shared state instance " << instance << " at " << argv[0] << "\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "\x1b[2J";
+	uint64_t shown = 0;
+	SharedSnapshot snapshot;
+	while (true) {
+		// polling the counter is one load, a snapshot is only taken for a new frame
+		if (reader.Frame(instance) != shown && reader.Read(instance, snapshot)) {
+			shown = snapshot.frame;
+			DrawSnapshot(snapshot);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+}
+
+// Function to fill a snapshot whose every field follows from n, so a torn copy shows
+static void Pattern(uint64_t n, SharedSnapshot& snapshot)
+{
+	for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+		snapshot.v[i] = static_cast<uint8_t>(n + i);
+	}
+	snapshot.index = static_cast<uint16_t>(n * 3);
+	snapshot.pc = static_cast<uint16_t>(n * 5);
+	snapshot.sp = static_cast<uint8_t>(n % STACK_LEVELS);
+	snapshot.delay = static_cast<uint8_t>(n * 7);
+	snapshot.sound = static_cast<uint8_t>(n * 11);
+	snapshot.fault = 0;
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		snapshot.rows[row] = n * 0x9E3779B97F4A7C15ull + row;
+	}
+}
+
+// Function to compare two snapshots field by field
+static bool SameSnapshot(SharedSnapshot const& a, SharedSnapshot const& b)
+{
+	return a.frame == b.frame && memcmp(a.v, b.v, sizeof(a.v)) == 0 && a.Control() == b.Control() &&
+		memcmp(a.rows, b.rows, sizeof(a.rows)) == 0;
+}
+
+// Function to check a seqlock under load across two processes
+static int Test(int argc, char* argv[])
+{
+	double seconds = argc > 0 ? std::stod(argv[0]) : 1.0;
+	string name = "/chip8-shm-test-" + std::to_string(getpid());
+
+	SharedStateExporter exporter(name.c_str(), 1);
+	if (!exporter.IsOpen()) {
+		std::cerr << "FAIL: can't create " << name << "\n";
+		return EXIT_FAILURE;
+	}
+
+	// published frame n carries pattern n - 1, the first publish makes it frame 1
+	SharedSnapshot snapshot;
+	Pattern(0, snapshot);
+	exporter.Publish(0, snapshot);
+
+	pid_t child = fork();
+	if (child == 0) {
+		SharedStateReader reader;
+		if (!reader.Open(name.c_str())) {
+			_exit(2);
+		}
+
+		uint64_t reads = 0, torn = 0, starved = 0;
+		SharedSnapshot seen, expected;
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+		while (std::chrono::steady_clock::now() < deadline) {
+			for (unsigned int i = 0; i < 1000; i++) {
+				if (!reader.Read(0, seen)) {
+					++starved;
+					continue;
+				}
+				Pattern(seen.frame - 1, expected);
+				expected.frame = seen.frame;
+				torn += !SameSnapshot(seen, expected);
+				++reads;
+			}
+		}
+
+		printf("  reader: %llu snapshots (%.1f M/s), %llu retried, %llu starved, %llu torn, last frame %llu\n",
+			static_cast<unsigned long long>(reads), reads / seconds / 1e6, static_cast<unsigned long long>(reader.Retries()),
+			static_cast<unsigned long long>(starved), static_cast<unsigned long long>(torn), static_cast<unsigned long long>(seen.frame));
+		// _exit skips stdio's buffers
+		fflush(stdout);
+		_exit(torn == 0 && reads > 0 ? 0 : 1);
+	}
+
+	uint64_t published = 1;
+	int status = 0;
+	while (waitpid(child, &status, WNOHANG) == 0) {
+		for (unsigned int i = 0; i < 1000; i++) {
+			Pattern(published++, snapshot);
+			exporter.Publish(0, snapshot);
+		}
+	}
+
+	printf("  writer: %llu frames published\n", static_cast<unsigned long long>(published));
+	bool passed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	printf("%s shared state snapshots are consistent\n", passed ? "PASS" : "FAIL");
+	return passed ? 0 : EXIT_FAILURE;
+}
+
+// Function to run the shared memory subcommands
+int SharedState(int argc, char* argv[])
+{
+	string mode = argc > 0 ? argv[0] : "";
+
+	if (mode == "view") {
+		return View(argc - 1, argv + 1);
+	}
+	if (mode == "test") {
+		return Test(argc - 1, argv + 1);
+	}
+
+	std::cerr << "Usage: shm view|test ...\n";
+	return EXIT_FAILURE;
+}
+
+#else
+
+// Function to report that shared memory export needs Linux
+int SharedState(int, char*[])
+{
+	std::cerr << "shm needs Linux\n";
+	return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,235 @@
+// *********************************************************
+//
+//			   FRAMEBUFFER STREAMING TOOLS
+//
+// *********************************************************
+
+// serve: runs several ROMs headless in one process, as scheduler sessions, and streams each as its own instance
+// view:  connects to a server and draws an instance in the terminal
+// test:  end-to-end check over loopback TCP and a Unix socket
+
+// Libraries
+#include "tools.h"
+#include "scheduler.h"
+#include "stream.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const unsigned int STREAM_CYCLES_PER_FRAME = 10;
+
+// Function to print a frame as text
+static void DrawFrame(CapturedFrame const& frame)
+{
+	string text = "\x1b[H";
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+		for (unsigned int col = 0; col < VIDEO_WIDTH; ++col) {
+			text += (frame.rows[row] >> (63 - col)) & 1u ? '#' : ' ';
+		}
+		text += "\n";
+	}
+	cout << text << "frame " << frame.frame << "   " << std::flush;
+}
+
+// Function to run ROMs headless at 60 frames per second and stream them
+static int Serve(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: stream serve <Port> <ROM>...\n";
+		return EXIT_FAILURE;
+	}
+
+	FrameServer server;
+	Scheduler scheduler(STREAM_CYCLES_PER_FRAME);
+
+	for (int rom = 1; rom < argc; rom++) {
+		scheduler.AddSession(argv[rom]);
+		server.AddInstance();
+	}
+
+	// only sessions that ran a frame can have drawn anything
+	scheduler.OnFrame([&server](unsigned int session, Chip8 const& chip8) {
+		server.Publish(session, chip8.display);
+	});
+
+	if (!server.ListenTcp(static_cast<uint16_t>(std::stoul(argv[0])))) {
+		std::cerr << "Can't listen on port " << argv[0] << "\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "Streaming " << scheduler.Sessions() << " instances on 127.0.0.1:" << server.Port() << "\n";
+
+	uint8_t keys[KEY_COUNT];
+	auto nextFrame = std::chrono::steady_clock::now();
+	while (true) {
+		for (unsigned int i = 0; i < scheduler.Sessions(); i++) {
+			server.ApplyKeys(i, keys);
+			scheduler.SetKeys(i, keys);
+		}
+		scheduler.RunFrame();
+
+		nextFrame += std::chrono::microseconds(1000000 / 60);
+		std::this_thread::sleep_until(nextFrame);
+	}
+}
+
+// Function to draw a streamed instance in the terminal
+static int View(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: stream view <Port | Unix socket path> <Instance>\n";
+		return EXIT_FAILURE;
+	}
+
+	FrameClient client;
+	string where = argv[0];
+	bool connected = where.find('/') != string::npos
+		? client.ConnectUnix(argv[0])
+		: client.ConnectTcp("127.0.0.1", static_cast<uint16_t>(std::stoul(where)));
+
+	if (!connected || !client.Subscribe(static_cast<uint16_t>(std::stoul(argv[1])))) {
+		std::cerr << "Can't connect to " << where << "\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "\x1b[2J";
+	CapturedFrame frame{};
+	while (client.Receive(frame)) {
+		DrawFrame(frame);
+	}
+
+	cout << "\nServer closed the stream\n";
+	return 0;
+}
+
+// Function to check one viewer received frames that match what was published
+static bool CheckViewer(FrameClient& client, vector<CapturedFrame> const& published, char const* name)
+{
+	CapturedFrame frame{};
+	uint32_t last = published.back().frame;
+
+	// frames may be coalesced when publishing outpaces the server, but every one received must match
+	while (frame.frame != last) {
+		if (!client.Receive(frame)) {
+			printf("FAIL %s: stream ended at frame %u\n", name, frame.frame);
+			return false;
+		}
+		if (frame.frame > 0 && memcmp(frame.rows, published[frame.frame - 1].rows, sizeof(frame.rows)) != 0) {
+			printf("FAIL %s: frame %u differs from the published one\n", name, frame.frame);
+			return false;
+		}
+	}
+
+	printf("PASS %s: reached frame %u\n", name, last);
+	return true;
+}
+
+// Function to stream two ROMs to several viewers over loopback and check what arrives
+static int Test(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: stream test <ROM> <ROM>\n";
+		return EXIT_FAILURE;
+	}
+
+	const unsigned int frames = 300;
+	string unixPath = "/tmp/chip8stream-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+	FrameServer tcpServer;
+	FrameServer unixServer;
+	Chip8 machines[2];
+	vector<CapturedFrame> published[2];
+
+	for (unsigned int i = 0; i < 2; i++) {
+		machines[i].LoadROM(argv[i]);
+		tcpServer.AddInstance();
+	}
+	unixServer.AddInstance();
+
+	if (!tcpServer.ListenTcp(0) || !unixServer.ListenUnix(unixPath.c_str())) {
+		std::cerr << "FAIL: can't listen\n";
+		return EXIT_FAILURE;
+	}
+
+	// three viewers on the first instance, one on the second, one over the Unix socket
+	FrameClient viewers[5];
+	bool connected = true;
+	for (unsigned int i = 0; i < 4; i++) {
+		connected &= viewers[i].ConnectTcp("127.0.0.1", tcpServer.Port()) && viewers[i].Subscribe(i < 3 ? 0 : 1);
+	}
+	connected &= viewers[4].ConnectUnix(unixPath.c_str()) && viewers[4].Subscribe(0);
+	if (!connected) {
+		std::cerr << "FAIL: can't connect\n";
+		return EXIT_FAILURE;
+	}
+
+	// each subscription is answered with a keyframe of the blank screen
+	CapturedFrame first;
+	for (auto& viewer : viewers) {
+		viewer.Receive(first);
+	}
+
+	// a key pressed by a viewer reaches the instance it's subscribed to, and only that one
+	viewers[3].SendKey(0x5, true);
+	uint8_t keys[2][KEY_COUNT]{};
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!keys[1][0x5] && std::chrono::steady_clock::now() < deadline) {
+		tcpServer.ApplyKeys(1, keys[1]);
+	}
+	tcpServer.ApplyKeys(0, keys[0]);
+	bool passed = keys[1][0x5] == 1 && keys[0][0x5] == 0;
+	printf("%s key event from a viewer\n", passed ? "PASS" : "FAIL");
+
+	// publish first, the viewers' sockets buffer everything that was sent
+	for (unsigned int frame = 1; frame <= frames; frame++) {
+		for (unsigned int i = 0; i < 2; i++) {
+			machines[i].RunCycles(STREAM_CYCLES_PER_FRAME);
+			tcpServer.Publish(i, machines[i].display);
+
+			CapturedFrame packed{};
+			packed.frame = frame;
+			memcpy(packed.rows, machines[i].display, sizeof(packed.rows));
+			published[i].push_back(packed);
+		}
+		unixServer.Publish(0, machines[0].display);
+
+		// pace publishing a little so most frames go out individually
+		if (frame % 50 == 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+
+	for (unsigned int i = 0; i < 5; i++) {
+		string name = i == 4 ? "unix viewer" : "tcp viewer " + std::to_string(i);
+		passed &= CheckViewer(viewers[i], published[i == 3 ? 1 : 0], name.c_str());
+	}
+
+	remove(unixPath.c_str());
+	return passed ? 0 : EXIT_FAILURE;
+}
+
+// Function to run the streaming subcommands
+int StreamFrames(int argc, char* argv[])
+{
+	string mode = argc > 0 ? argv[0] : "";
+
+	if (mode == "serve") {
+		return Serve(argc - 1, argv + 1);
+	}
+	if (mode == "view") {
+		return View(argc - 1, argv + 1);
+	}
+	if (mode == "test") {
+		return Test(argc - 1, argv + 1);
+	}
+
+	std::cerr << "Usage: stream serve|view|test ...\n";
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,117 @@
+// *********************************************************
+//
+//				  CHIP 8 DEVELOPER TOOLS
+//
+// *********************************************************
+
+// Libraries
+#include "tools.h"
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <Command> [Arguments]\n";
+		std::cerr << "Commands:\n";
+		std::cerr << "  mine <Cycles> <ROM>...    most frequent opcode pairs and triples\n";
+		std::cerr << "  bench <Cycles> <ROM> [Batch]   instructions per second of each execution path\n";
+		std::cerr << "  instances <Count>         bytes per instance and construction time\n";
+		std::cerr << "  envbench <Environments> <Steps> <ROM> [Frames] [MaxThreads]   batched environment API steps per second\n";
+		std::cerr << "  golden record|check <ROM> <Golden> ...   golden frame regression harness\n";
+		std::cerr << "  capconv <Capture> <Output.y4m | PNG prefix> [Scale]   convert a display capture\n";
+		std::cerr << "  stream serve|view|test ...   stream displays over sockets\n";
+		std::cerr << "  gdb <Port> <ROM>          debug a ROM with gdb (target remote :Port)\n";
+		std::cerr << "  fuzz <Seconds> [Seed ROM]...   run mutated ROMs through the core\n";
+		std::cerr << "  sessions <Count> <Frames> <ROM>...   schedule many sessions as coroutines\n";
+		std::cerr << "  trace record|diff ...     record execution traces and find where two diverge\n";
+		std::cerr << "  lockstep <Interval> <Cycles> <ROM>...   check the fast engine against the reference\n";
+		std::cerr << "  clone <Clones> <ROM> [Frames]   grow a search tree from copy-on-write clones\n";
+		std::cerr << "  netplay peer|test ...     two-player rollback netplay over UDP\n";
+		std::cerr << "  shm view|test ...         read machines exported to shared memory\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	string command = argv[1];
+
+	if (command == "mine")
+	{
+		return MineOpcodes(argc - 2, argv + 2);
+	}
+
+	if (command == "bench")
+	{
+		return BenchROM(argc - 2, argv + 2);
+	}
+
+	if (command == "instances")
+	{
+		return BenchInstances(argc - 2, argv + 2);
+	}
+
+	if (command == "envbench")
+	{
+		return BenchEnvironments(argc - 2, argv + 2);
+	}
+
+	if (command == "golden")
+	{
+		return GoldenFrames(argc - 2, argv + 2);
+	}
+
+	if (command == "capconv")
+	{
+		return ConvertCapture(argc - 2, argv + 2);
+	}
+
+	if (command == "stream")
+	{
+		return StreamFrames(argc - 2, argv + 2);
+	}
+
+	if (command == "gdb")
+	{
+		return DebugROM(argc - 2, argv + 2);
+	}
+
+	if (command == "fuzz")
+	{
+		return FuzzROMs(argc - 2, argv + 2);
+	}
+
+	if (command == "sessions")
+	{
+		return RunSessions(argc - 2, argv + 2);
+	}
+
+	if (command == "trace")
+	{
+		return TraceROM(argc - 2, argv + 2);
+	}
+
+	if (command == "lockstep")
+	{
+		return CheckLockstep(argc - 2, argv + 2);
+	}
+
+	if (command == "clone")
+	{
+		return CloneSearch(argc - 2, argv + 2);
+	}
+
+	if (command == "netplay")
+	{
+		return Netplay(argc - 2, argv + 2);
+	}
+
+	if (command == "shm")
+	{
+		return SharedState(argc - 2, argv + 2);
+	}
+
+	std::cerr << "Unknown command: " << command << "\n";
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// Each developer tool is a subcommand of Chip8Tools, taking the arguments after its name
+
+// Counts the most frequent executed opcode pairs and triples over a set of ROMs
+int MineOpcodes(int argc, char* argv[]);
+
+// Times the execution paths of the core on a ROM and checks they agree
+int BenchROM(int argc, char* argv[]);
+
+// Reports the size of a Chip8 and how fast instances are created, with and without the pool
+int BenchInstances(int argc, char* argv[]);
+
+// Steps a batch of environments through the C API and reports steps per second per thread count
+int BenchEnvironments(int argc, char* argv[]);
+
+// Records golden per-frame display hashes of a ROM, or checks a run against them
+int GoldenFrames(int argc, char* argv[]);
+
+// Converts a display capture into a Y4M video or a PNG sequence
+int ConvertCapture(int argc, char* argv[]);
+
+// Streams headless ROMs over a socket, views a stream, or tests streaming over loopback
+int StreamFrames(int argc, char* argv[]);
+
+// Serves a ROM to gdb over the remote serial protocol
+int DebugROM(int argc, char* argv[]);
+
+// Runs mutated ROMs through the core and reports executions per second
+int FuzzROMs(int argc, char* argv[]);
+
+// Runs many sessions through the coroutine scheduler and checks them against stepping every frame
+int RunSessions(int argc, char* argv[]);
+
+// Records the execution trace of a ROM, or reports where two traces diverge
+int TraceROM(int argc, char* argv[]);
+
+// Runs ROMs on the fast engine in lockstep with the reference interpreter and reports any divergence
+int CheckLockstep(int argc, char* argv[]);
+
+// Grows a random search tree from copy-on-write clones and checks it against full machine copies
+int CloneSearch(int argc, char* argv[]);
+
+// Plays one side of a rollback netplay session, or tests both sides over loopback UDP
+int Netplay(int argc, char* argv[]);
+
+// Views a machine exported to shared memory, or checks the shared memory seqlock under load
+int SharedState(int argc, char* argv[]);
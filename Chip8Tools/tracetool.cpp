@@ -0,0 +1,194 @@
+// *********************************************************
+//
+//			   EXECUTION TRACE RECORD AND DIFF
+//
+// *********************************************************
+
+// record: runs a ROM headless with a TraceRecorder attached and reports what tracing costs
+// diff:   walks two traces in step and reports the first instruction where they disagree,
+//         for telling where two builds of the core part ways on the same ROM
+
+// Libraries
+#include "tools.h"
+#include "chip8.h"
+#include "trace.h"
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+const unsigned int TRACE_DEFAULT_FRAMES = 3600;
+const unsigned int TRACE_DEFAULT_CONTEXT = 8;
+
+// Function to print one traced instruction
+static void PrintRecord(char const* label, uint64_t number, TraceRecord const& record)
+{
+	printf("%s #%-10llu pc %03X  op %04X  ", label, static_cast<unsigned long long>(number), record.pc, record.opcode);
+	if (record.reg != TRACE_NO_REGISTER) {
+		printf("V%X=%02X  ", record.reg, record.value);
+	}
+	else {
+		printf("       ");
+	}
+	printf("I=%03X  VF=%02X\n", record.index, record.vf);
+}
+
+// Function to name the fields two records disagree on
+static string Differences(TraceRecord const& a, TraceRecord const& b)
+{
+	string fields;
+	auto add = [&fields](bool differs, char const* name) {
+		if (differs) {
+			fields += fields.empty() ? name : string(", ") + name;
+		}
+	};
+
+	add(a.pc != b.pc, "pc");
+	add(a.opcode != b.opcode, "opcode");
+	add(a.reg != b.reg || a.value != b.value, "changed register");
+	add(a.index != b.index, "I");
+	add(a.vf != b.vf, "VF");
+	return fields;
+}
+
+// Function to run a ROM for a number of frames, traced or not, returning the time it took in seconds
+static double RunROM(char const* romFilename, unsigned int frames, unsigned int cyclesPerFrame, TraceRecorder* tracer)
+{
+	// machines are big enough that the stack isn't the place for them
+	auto chip8 = std::make_unique<Chip8>();
+	chip8->SeedRandom(0);
+	chip8->SetCyclesPerFrame(cyclesPerFrame);
+	chip8->LoadROM(romFilename);
+	chip8->AttachTracer(tracer);
+
+	// tracing turns fusion off, so the untraced run does too to time the same work
+	chip8->SetFusion(false);
+
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int frame = 0; frame < frames; frame++) {
+		if (chip8->RunUntilFrame().stop == STOP_FAULT) {
+			break;
+		}
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Function to record the trace of a ROM run headless
+static int Record(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: trace record <ROM> <Trace> [Frames] [Cycles per frame]\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned int frames = argc > 2 ? std::stoul(argv[2]) : TRACE_DEFAULT_FRAMES;
+	unsigned int cyclesPerFrame = argc > 3 ? std::stoul(argv[3]) : DEFAULT_CYCLES_PER_FRAME;
+
+	double plain = RunROM(argv[0], frames, cyclesPerFrame, nullptr);
+
+	TraceRecorder recorder(argv[1]);
+	if (!recorder.IsOpen()) {
+		std::cerr << "Can't open " << argv[1] << "\n";
+		return EXIT_FAILURE;
+	}
+	double traced = RunROM(argv[0], frames, cyclesPerFrame, &recorder);
+	recorder.Close();
+
+	uint64_t records = recorder.Recorded();
+	printf("Traced %llu instructions to %s, %llu bytes (%.2f bytes per instruction)\n",
+		static_cast<unsigned long long>(records), argv[1], static_cast<unsigned long long>(recorder.Bytes()),
+		records ? static_cast<double>(recorder.Bytes()) / records : 0.0);
+	printf("  untraced %8.3f ms  %8.2f Minstr/s\n", plain * 1000.0, records / plain / 1e6);
+	printf("  traced   %8.3f ms  %8.2f Minstr/s  (waited for the writer %llu times)\n",
+		traced * 1000.0, records / traced / 1e6, static_cast<unsigned long long>(recorder.Stalls()));
+	return 0;
+}
+
+// Function to report the first instruction where two traces disagree
+static int Diff(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: trace diff <Trace> <Trace> [Context]\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned int context = argc > 2 ? std::stoul(argv[2]) : TRACE_DEFAULT_CONTEXT;
+
+	TraceReader traces[2];
+	for (unsigned int i = 0; i < 2; i++) {
+		if (!traces[i].Open(argv[i])) {
+			std::cerr << "Can't read trace " << argv[i] << "\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	// the instructions leading up to a divergence, identical in both traces
+	std::deque<TraceRecord> recent;
+	TraceRecord records[2];
+	bool more[2];
+	uint64_t number = 0;
+
+	while (true) {
+		more[0] = traces[0].Next(records[0]);
+		more[1] = traces[1].Next(records[1]);
+
+		if (!more[0] && !more[1]) {
+			printf("SAME %llu instructions\n", static_cast<unsigned long long>(number));
+			return 0;
+		}
+
+		if (more[0] != more[1] || !Differences(records[0], records[1]).empty()) {
+			break;
+		}
+
+		recent.push_back(records[0]);
+		if (recent.size() > context) {
+			recent.pop_front();
+		}
+		++number;
+	}
+
+	if (more[0] && more[1]) {
+		printf("DIFFER at instruction %llu: %s\n", static_cast<unsigned long long>(number), Differences(records[0], records[1]).c_str());
+	}
+	else {
+		printf("DIFFER at instruction %llu: %s ends first\n", static_cast<unsigned long long>(number), argv[more[0] ? 1 : 0]);
+	}
+
+	uint64_t first = number - recent.size();
+	for (auto const& record : recent) {
+		PrintRecord("   ", first++, record);
+	}
+
+	// the divergent instruction and a few after it, from each side
+	for (unsigned int i = 0; i < 2; i++) {
+		char const* label = i == 0 ? "A  " : "B  ";
+		for (unsigned int after = 0; more[i] && after <= context / 2; after++) {
+			PrintRecord(label, number + after, records[i]);
+			more[i] = traces[i].Next(records[i]);
+		}
+	}
+
+	return EXIT_FAILURE;
+}
+
+// Function to run the trace subcommands
+int TraceROM(int argc, char* argv[])
+{
+	string mode = argc > 0 ? argv[0] : "";
+
+	if (mode == "record") {
+		return Record(argc - 1, argv + 1);
+	}
+	if (mode == "diff") {
+		return Diff(argc - 1, argv + 1);
+	}
+
+	std::cerr << "Usage: trace record|diff ...\n";
+	return EXIT_FAILURE;
+}